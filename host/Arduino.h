@@ -0,0 +1,94 @@
+/**
+ *  \file Arduino.h
+ *  \brief Host stand-in for the Arduino core header.
+ *  \details Provides the subset of the Arduino Mega 2560 core API that the firmware
+ *  uses so that module_handler.cpp and all sensor/actuator modules compile unchanged
+ *  into a Linux binary. Pins are mapped onto AVR style port registers (PINx, DDRx, PORTx)
+ *  with pin n on port n/8, bit n%8. See host_hal.h for the simulation controls.
+ *  \author Jake Rye
+ */
+#ifndef Arduino_h
+#define Arduino_h
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "avr/io.h"
+#include "avr/pgmspace.h"
+
+typedef uint8_t byte;
+typedef bool boolean;
+typedef unsigned int word;
+
+#define HIGH 0x1
+#define LOW  0x0
+
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+
+#define NUM_DIGITAL_PINS 70
+#define NUM_ANALOG_INPUTS 16
+
+static const uint8_t A0 = 54;
+static const uint8_t A1 = 55;
+static const uint8_t A2 = 56;
+static const uint8_t A3 = 57;
+static const uint8_t A4 = 58;
+static const uint8_t A5 = 59;
+static const uint8_t A6 = 60;
+static const uint8_t A7 = 61;
+static const uint8_t A8 = 62;
+static const uint8_t A9 = 63;
+static const uint8_t A10 = 64;
+static const uint8_t A11 = 65;
+static const uint8_t A12 = 66;
+static const uint8_t A13 = 67;
+static const uint8_t A14 = 68;
+static const uint8_t A15 = 69;
+
+// Port Register Mapping (pin n lives on port n/8, bit n%8)
+#define digitalPinToPort(pin) ((pin) >> 3)
+#define digitalPinToBitMask(pin) ((uint8_t)(1 << ((pin) & 0x07)))
+#define portInputRegister(port) (&host_port_registers[(port) * 3])
+#define portModeRegister(port) (&host_port_registers[(port) * 3 + 1])
+#define portOutputRegister(port) (&host_port_registers[(port) * 3 + 2])
+
+// Digital & Analog I/O
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+int analogRead(uint8_t pin);
+
+// Time
+unsigned long millis(void);
+unsigned long micros(void);
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+// Interrupts
+void interrupts(void);
+void noInterrupts(void);
+#define sei() interrupts()
+#define cli() noInterrupts()
+
+// External Interrupts, Numbered As On The Mega (pins 2, 3, 21, 20, 19 & 18)
+#define CHANGE 1
+#define FALLING 2
+#define RISING 3
+#define NOT_AN_INTERRUPT -1
+#define digitalPinToInterrupt(p) ((p) == 2 ? 0 : ((p) == 3 ? 1 : ((p) >= 18 && (p) <= 21 ? 23 - (p) : NOT_AN_INTERRUPT)))
+void attachInterrupt(uint8_t interrupt, void (*handler)(void), int mode);
+void detachInterrupt(uint8_t interrupt);
+
+// Sketch Entry Points
+void setup(void);
+void loop(void);
+
+#include "WString.h"
+#include "HardwareSerial.h"
+#include "host_hal.h"
+
+#endif // Arduino_h
@@ -0,0 +1,151 @@
+/**
+ *  \file HardwareSerial.cpp
+ *  \brief Host stand-in for the Arduino HardwareSerial class.
+ *  \details See HardwareSerial.h for details.
+ *  \author Jake Rye
+ */
+#include "Arduino.h"
+
+#include <deque>
+
+HardwareSerial Serial;
+
+struct PendingByte {
+  uint8_t c;
+  uint64_t arrival_us;
+};
+
+static HostSerialPeer *peer_ = NULL;
+static HostSerialStats serial_stats_;
+static uint64_t tx_idle_at_us_ = 0; // when the uart finishes shifting out the queued bytes
+static uint64_t rx_idle_at_us_ = 0; // when the last injected byte has arrived
+static std::deque<PendingByte> rx_pending_; // injected bytes still on the wire
+static unsigned long link_limit_ = 0; // highest baud rate the wire carries, 0 for no limit
+
+//-------------------------------------------------PRIVATE-------------------------------------------//
+static uint64_t byteMicroseconds(unsigned long baud) {
+  return baud ? (10 * 1000000UL + baud - 1) / baud : 0; // start, 8 data, stop
+}
+
+static uint8_t carry(uint8_t c, unsigned long baud) {
+  // Garble Bytes When The Ends Disagree On The Rate Or The Wire Cannot Carry It
+  bool rate_matches = !peer_ || !peer_->baud() || (peer_->baud() == baud);
+  bool link_carries = !link_limit_ || (baud <= link_limit_);
+  return (rate_matches && link_carries) ? c : (uint8_t)(c ^ 0xA5);
+}
+
+//--------------------------------------------------PUBLIC-------------------------------------------//
+HardwareSerial::HardwareSerial(void) {
+  rx_head_ = 0;
+  rx_tail_ = 0;
+  baud_ = 0;
+}
+
+void HardwareSerial::begin(unsigned long baud) {
+  baud_ = baud;
+}
+
+void HardwareSerial::end(void) {
+  rx_head_ = rx_tail_;
+}
+
+int HardwareSerial::available(void) {
+  receivePending();
+  return (SERIAL_RX_BUFFER_SIZE + rx_head_ - rx_tail_) % SERIAL_RX_BUFFER_SIZE;
+}
+
+int HardwareSerial::peek(void) {
+  receivePending();
+  if (rx_head_ == rx_tail_) {
+    return -1;
+  }
+  return rx_buffer_[rx_tail_];
+}
+
+int HardwareSerial::read(void) {
+  receivePending();
+  if (rx_head_ == rx_tail_) {
+    return -1;
+  }
+  uint8_t c = rx_buffer_[rx_tail_];
+  rx_tail_ = (rx_tail_ + 1) % SERIAL_RX_BUFFER_SIZE;
+  return c;
+}
+
+void HardwareSerial::flush(void) {
+  // Wait For Transmission Of Outgoing Data To Complete
+  if (tx_idle_at_us_ > hostNow()) {
+    hostSpend(NULL, "HardwareSerial::flush", kHostTimeIo, tx_idle_at_us_ - hostNow());
+  }
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+  // Block While The Transmit Buffer Is Full
+  uint64_t byte_us = byteMicroseconds(baud_);
+  uint64_t now = hostNow();
+  if (tx_idle_at_us_ < now) {
+    tx_idle_at_us_ = now;
+  }
+  if (byte_us && (tx_idle_at_us_ - now) >= SERIAL_TX_BUFFER_SIZE * byte_us) {
+    uint64_t space_at = tx_idle_at_us_ - (SERIAL_TX_BUFFER_SIZE - 1) * byte_us;
+    hostSpend(NULL, "HardwareSerial::write", kHostTimeIo, space_at - now);
+  }
+  tx_idle_at_us_ += byte_us;
+
+  serial_stats_.tx_bytes++;
+  if (peer_) {
+    peer_->onBoardByte(carry(c, baud_));
+  }
+  return 1;
+}
+
+void HardwareSerial::inject(const uint8_t *buffer, size_t size) {
+  // Queue Bytes On The Wire, One Byte Time Apart At The Configured Baud Rate
+  uint64_t byte_us = byteMicroseconds(baud_);
+  if (rx_idle_at_us_ < hostNow()) {
+    rx_idle_at_us_ = hostNow();
+  }
+  for (size_t i = 0; i < size; i++) {
+    rx_idle_at_us_ += byte_us;
+    PendingByte pending = {carry(buffer[i], baud_), rx_idle_at_us_};
+    rx_pending_.push_back(pending);
+  }
+  receivePending();
+}
+
+void HardwareSerial::receivePending(void) {
+  // Move Bytes That Have Arrived Into The Receive Buffer
+  while (!rx_pending_.empty() && rx_pending_.front().arrival_us <= hostNow()) {
+    uint8_t c = rx_pending_.front().c;
+    rx_pending_.pop_front();
+    uint8_t next_head = (rx_head_ + 1) % SERIAL_RX_BUFFER_SIZE;
+    if (next_head == rx_tail_) { // buffer full, byte is lost like on the board
+      serial_stats_.rx_overflows++;
+      continue;
+    }
+    rx_buffer_[rx_head_] = c;
+    rx_head_ = next_head;
+    serial_stats_.rx_bytes++;
+  }
+}
+
+bool HardwareSerial::receiving(void) {
+  return !rx_pending_.empty();
+}
+
+//-------------------------------------------------HOST----------------------------------------------//
+void hostSerialAttachPeer(HostSerialPeer *peer) {
+  peer_ = peer;
+}
+
+void hostSerialInject(const uint8_t *buffer, size_t size) {
+  Serial.inject(buffer, size);
+}
+
+void hostSerialSetLinkLimit(unsigned long baud) {
+  link_limit_ = baud;
+}
+
+HostSerialStats hostSerialStats(void) {
+  return serial_stats_;
+}
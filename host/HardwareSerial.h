@@ -0,0 +1,52 @@
+/**
+ *  \file HardwareSerial.h
+ *  \brief Host stand-in for the Arduino HardwareSerial class.
+ *  \details Bytes written by the firmware are handed to the attached HostSerialPeer
+ *  (see host_hal.h), bytes injected by the peer are queued for read(). Both directions
+ *  run at the configured baud rate: injected bytes reach the 64 byte receive buffer one
+ *  byte time apart, and write() blocks on the virtual clock once the 64 byte transmit
+ *  buffer is full, like the AVR core. Bytes are garbled when the peer's uart is set to
+ *  another rate, or the rate is above the link limit set with hostSerialSetLinkLimit().
+ *  \author Jake Rye
+ */
+#ifndef HardwareSerial_h
+#define HardwareSerial_h
+
+#include "Stream.h"
+
+#define SERIAL_TX_BUFFER_SIZE 64
+#define SERIAL_RX_BUFFER_SIZE 64
+
+/**
+ * \brief Host stand-in for the Arduino HardwareSerial class.
+ */
+class HardwareSerial : public Stream {
+  public:
+    HardwareSerial(void);
+    void begin(unsigned long baud);
+    void end(void);
+    virtual int available(void);
+    virtual int peek(void);
+    virtual int read(void);
+    virtual void flush(void);
+    virtual size_t write(uint8_t c);
+    using Print::write;
+    operator bool() { return true; }
+
+    // Host Functions
+    void inject(const uint8_t *buffer, size_t size);
+    bool receiving(void); // injected bytes are still on the wire
+    unsigned long baud(void) { return baud_; }
+
+  private:
+    void receivePending(void);
+
+    uint8_t rx_buffer_[SERIAL_RX_BUFFER_SIZE];
+    uint8_t rx_head_;
+    uint8_t rx_tail_;
+    unsigned long baud_;
+};
+
+extern HardwareSerial Serial;
+
+#endif // HardwareSerial_h
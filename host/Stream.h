@@ -0,0 +1,22 @@
+/**
+ *  \file Stream.h
+ *  \brief Host stand-in for the Arduino Stream class.
+ *  \author Jake Rye
+ */
+#ifndef Stream_h
+#define Stream_h
+
+#include "Print.h"
+
+/**
+ * \brief Host stand-in for the Arduino Stream class.
+ */
+class Stream : public Print {
+  public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+    virtual void flush() = 0;
+};
+
+#endif // Stream_h
@@ -0,0 +1,412 @@
+/**
+ *  \file WString.cpp
+ *  \brief Host stand-in for the Arduino String class.
+ *  \details See WString.h for details.
+ *  \author Jake Rye
+ */
+#include "WString.h"
+
+#include <ctype.h>
+#include <stdio.h>
+
+#include "host_hal.h"
+
+//--------------------------------------------------PUBLIC-------------------------------------------//
+String::String(const char *cstr) {
+  invalidate();
+  if (cstr) {
+    copy(cstr, strlen(cstr));
+  }
+}
+
+String::String(const String &value) {
+  invalidate();
+  *this = value;
+}
+
+String::String(const __FlashStringHelper *str) {
+  invalidate();
+  *this = str;
+}
+
+String::String(char c) {
+  invalidate();
+  char buf[2] = {c, 0};
+  *this = buf;
+}
+
+String::String(unsigned char value, unsigned char base) {
+  invalidate();
+  char buf[1 + 8 * sizeof(unsigned char)];
+  snprintf(buf, sizeof(buf), base == 16 ? "%x" : "%u", value);
+  *this = buf;
+}
+
+String::String(int value, unsigned char base) {
+  invalidate();
+  char buf[2 + 8 * sizeof(int)];
+  snprintf(buf, sizeof(buf), base == 16 ? "%x" : "%d", value);
+  *this = buf;
+}
+
+String::String(unsigned int value, unsigned char base) {
+  invalidate();
+  char buf[1 + 8 * sizeof(unsigned int)];
+  snprintf(buf, sizeof(buf), base == 16 ? "%x" : "%u", value);
+  *this = buf;
+}
+
+String::String(long value, unsigned char base) {
+  invalidate();
+  char buf[2 + 8 * sizeof(long)];
+  snprintf(buf, sizeof(buf), base == 16 ? "%lx" : "%ld", value);
+  *this = buf;
+}
+
+String::String(unsigned long value, unsigned char base) {
+  invalidate();
+  char buf[1 + 8 * sizeof(unsigned long)];
+  snprintf(buf, sizeof(buf), base == 16 ? "%lx" : "%lu", value);
+  *this = buf;
+}
+
+String::String(float value, unsigned char decimal_places) {
+  invalidate();
+  char buf[33];
+  snprintf(buf, sizeof(buf), "%.*f", decimal_places, (double)value);
+  *this = buf;
+}
+
+String::String(double value, unsigned char decimal_places) {
+  invalidate();
+  char buf[33];
+  snprintf(buf, sizeof(buf), "%.*f", decimal_places, value);
+  *this = buf;
+}
+
+String::~String(void) {
+  hostHeapFree(buffer_, capacity_ + 1);
+}
+
+unsigned char String::reserve(unsigned int size) {
+  if (buffer_ && capacity_ >= size) {
+    return 1;
+  }
+  if (changeBuffer(size)) {
+    if (len_ == 0) {
+      buffer_[0] = 0;
+    }
+    return 1;
+  }
+  return 0;
+}
+
+String & String::operator = (const String &rhs) {
+  if (this == &rhs) {
+    return *this;
+  }
+  if (rhs.buffer_) {
+    copy(rhs.buffer_, rhs.len_);
+  }
+  else {
+    hostHeapFree(buffer_, capacity_ + 1);
+    invalidate();
+  }
+  return *this;
+}
+
+String & String::operator = (const __FlashStringHelper *str) {
+  return *this = reinterpret_cast<const char *>(str);
+}
+
+String & String::operator = (const char *cstr) {
+  if (cstr) {
+    copy(cstr, strlen(cstr));
+  }
+  else {
+    hostHeapFree(buffer_, capacity_ + 1);
+    invalidate();
+  }
+  return *this;
+}
+
+unsigned char String::concat(const String &str) {
+  return concat(str.buffer_, str.len_);
+}
+
+unsigned char String::concat(const __FlashStringHelper *str) {
+  return concat(reinterpret_cast<const char *>(str));
+}
+
+unsigned char String::concat(const char *cstr) {
+  if (!cstr) {
+    return 0;
+  }
+  return concat(cstr, strlen(cstr));
+}
+
+unsigned char String::concat(char c) {
+  char buf[2] = {c, 0};
+  return concat(buf, 1);
+}
+
+unsigned char String::concat(unsigned char num) {
+  char buf[4];
+  snprintf(buf, sizeof(buf), "%u", num);
+  return concat(buf, strlen(buf));
+}
+
+unsigned char String::concat(int num) {
+  char buf[12];
+  snprintf(buf, sizeof(buf), "%d", num);
+  return concat(buf, strlen(buf));
+}
+
+unsigned char String::concat(unsigned int num) {
+  char buf[11];
+  snprintf(buf, sizeof(buf), "%u", num);
+  return concat(buf, strlen(buf));
+}
+
+unsigned char String::concat(long num) {
+  char buf[21];
+  snprintf(buf, sizeof(buf), "%ld", num);
+  return concat(buf, strlen(buf));
+}
+
+unsigned char String::concat(unsigned long num) {
+  char buf[21];
+  snprintf(buf, sizeof(buf), "%lu", num);
+  return concat(buf, strlen(buf));
+}
+
+unsigned char String::concat(float num) {
+  char buf[20];
+  snprintf(buf, sizeof(buf), "%.2f", (double)num);
+  return concat(buf, strlen(buf));
+}
+
+unsigned char String::concat(double num) {
+  char buf[20];
+  snprintf(buf, sizeof(buf), "%.2f", num);
+  return concat(buf, strlen(buf));
+}
+
+String operator + (const String &lhs, const String &rhs) {
+  String result(lhs);
+  result.concat(rhs);
+  return result;
+}
+
+String operator + (const String &lhs, const char *cstr) {
+  String result(lhs);
+  result.concat(cstr);
+  return result;
+}
+
+String operator + (const String &lhs, const __FlashStringHelper *str) {
+  String result(lhs);
+  result.concat(str);
+  return result;
+}
+
+String operator + (const char *cstr, const String &rhs) {
+  String result(cstr);
+  result.concat(rhs);
+  return result;
+}
+
+String operator + (const String &lhs, char c) {
+  String result(lhs);
+  result.concat(c);
+  return result;
+}
+
+unsigned char String::equals(const String &str) const {
+  return (len_ == str.len_) && (strcmp(c_str(), str.c_str()) == 0);
+}
+
+unsigned char String::equals(const char *cstr) const {
+  if (len_ == 0) {
+    return (cstr == NULL) || (*cstr == 0);
+  }
+  if (cstr == NULL) {
+    return buffer_[0] == 0;
+  }
+  return strcmp(buffer_, cstr) == 0;
+}
+
+unsigned char String::startsWith(const String &prefix) const {
+  if (len_ < prefix.len_) {
+    return 0;
+  }
+  return strncmp(c_str(), prefix.c_str(), prefix.len_) == 0;
+}
+
+char String::charAt(unsigned int index) const {
+  return operator[](index);
+}
+
+void String::setCharAt(unsigned int index, char c) {
+  if (index < len_) {
+    buffer_[index] = c;
+  }
+}
+
+char String::operator [] (unsigned int index) const {
+  if (index >= len_ || !buffer_) {
+    return 0;
+  }
+  return buffer_[index];
+}
+
+char & String::operator [] (unsigned int index) {
+  if (index >= len_ || !buffer_) {
+    dummy_writable_char_ = 0;
+    return dummy_writable_char_;
+  }
+  return buffer_[index];
+}
+
+int String::indexOf(char ch) const {
+  return indexOf(ch, 0);
+}
+
+int String::indexOf(char ch, unsigned int from_index) const {
+  if (from_index >= len_) {
+    return -1;
+  }
+  const char *found = (const char *)memchr(buffer_ + from_index, ch, len_ - from_index);
+  if (found == NULL) {
+    return -1;
+  }
+  return found - buffer_;
+}
+
+int String::indexOf(const String &str) const {
+  return indexOf(str, 0);
+}
+
+int String::indexOf(const String &str, unsigned int from_index) const {
+  if (from_index >= len_) {
+    return -1;
+  }
+  const char *found = strstr(buffer_ + from_index, str.c_str());
+  if (found == NULL) {
+    return -1;
+  }
+  return found - buffer_;
+}
+
+int String::lastIndexOf(char ch) const {
+  if (len_ == 0) {
+    return -1;
+  }
+  const char *found = strrchr(buffer_, ch);
+  if (found == NULL) {
+    return -1;
+  }
+  return found - buffer_;
+}
+
+String String::substring(unsigned int begin_index, unsigned int end_index) const {
+  if (begin_index > end_index) {
+    unsigned int temp = end_index;
+    end_index = begin_index;
+    begin_index = temp;
+  }
+  String result;
+  if (begin_index >= len_) {
+    return result;
+  }
+  if (end_index > len_) {
+    end_index = len_;
+  }
+  result.copy(buffer_ + begin_index, end_index - begin_index);
+  return result;
+}
+
+void String::trim(void) {
+  if (!buffer_ || len_ == 0) {
+    return;
+  }
+  char *begin = buffer_;
+  while (isspace(*begin)) {
+    begin++;
+  }
+  char *end = buffer_ + len_ - 1;
+  while (isspace(*end) && end >= begin) {
+    end--;
+  }
+  len_ = end + 1 - begin;
+  if (begin > buffer_) {
+    memmove(buffer_, begin, len_);
+  }
+  buffer_[len_] = 0;
+}
+
+void String::toUpperCase(void) {
+  for (unsigned int i = 0; i < len_; i++) {
+    buffer_[i] = toupper(buffer_[i]);
+  }
+}
+
+long String::toInt(void) const {
+  if (buffer_) {
+    return atol(buffer_);
+  }
+  return 0;
+}
+
+float String::toFloat(void) const {
+  if (buffer_) {
+    return (float)atof(buffer_);
+  }
+  return 0;
+}
+
+//-------------------------------------------------PRIVATE-------------------------------------------//
+void String::invalidate(void) {
+  buffer_ = NULL;
+  capacity_ = 0;
+  len_ = 0;
+}
+
+unsigned char String::changeBuffer(unsigned int max_str_len) {
+  char *new_buffer = (char *)hostHeapRealloc(buffer_, buffer_ ? capacity_ + 1 : 0, max_str_len + 1);
+  if (new_buffer) {
+    buffer_ = new_buffer;
+    capacity_ = max_str_len;
+    return 1;
+  }
+  return 0;
+}
+
+unsigned char String::concat(const char *cstr, unsigned int length) {
+  unsigned int new_length = len_ + length;
+  if (!cstr) {
+    return 0;
+  }
+  if (length == 0) {
+    return 1;
+  }
+  if (!reserve(new_length)) {
+    return 0;
+  }
+  memmove(buffer_ + len_, cstr, length);
+  len_ = new_length;
+  buffer_[len_] = 0;
+  return 1;
+}
+
+String & String::copy(const char *cstr, unsigned int length) {
+  if (!reserve(length)) {
+    hostHeapFree(buffer_, capacity_ + 1);
+    invalidate();
+    return *this;
+  }
+  len_ = length;
+  memmove(buffer_, cstr, length);
+  buffer_[len_] = 0;
+  return *this;
+}
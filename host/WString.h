@@ -0,0 +1,124 @@
+/**
+ *  \file WString.h
+ *  \brief Host stand-in for the Arduino String class.
+ *  \details Mirrors the subset of the Arduino core String API used by the firmware.
+ *  Buffers are grown with realloc() to exactly the length needed, like the AVR core,
+ *  so the heap statistics collected in host_hal.h are representative of the board. F()
+ *  strings get their own type as on the board, so only the calls that take them compile.
+ *  \author Jake Rye
+ */
+#ifndef String_class_h
+#define String_class_h
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "avr/pgmspace.h"
+
+class __FlashStringHelper; // a string in program memory
+#define F(string_literal) (reinterpret_cast<const __FlashStringHelper *>(PSTR(string_literal)))
+
+/**
+ * \brief Host stand-in for the Arduino String class.
+ */
+class String {
+  public:
+    // Constructors
+    String(const char *cstr = "");
+    String(const String &str);
+    String(const __FlashStringHelper *str);
+    explicit String(char c);
+    explicit String(unsigned char value, unsigned char base = 10);
+    explicit String(int value, unsigned char base = 10);
+    explicit String(unsigned int value, unsigned char base = 10);
+    explicit String(long value, unsigned char base = 10);
+    explicit String(unsigned long value, unsigned char base = 10);
+    explicit String(float value, unsigned char decimal_places = 2);
+    explicit String(double value, unsigned char decimal_places = 2);
+    ~String(void);
+
+    // Memory Management
+    unsigned char reserve(unsigned int size);
+    unsigned int length(void) const { return len_; }
+
+    // Assignment
+    String & operator = (const String &rhs);
+    String & operator = (const char *cstr);
+    String & operator = (const __FlashStringHelper *str);
+
+    // Concatenation
+    unsigned char concat(const String &str);
+    unsigned char concat(const char *cstr);
+    unsigned char concat(const __FlashStringHelper *str);
+    unsigned char concat(char c);
+    unsigned char concat(unsigned char num);
+    unsigned char concat(int num);
+    unsigned char concat(unsigned int num);
+    unsigned char concat(long num);
+    unsigned char concat(unsigned long num);
+    unsigned char concat(float num);
+    unsigned char concat(double num);
+    String & operator += (const String &rhs) { concat(rhs); return (*this); }
+    String & operator += (const char *cstr) { concat(cstr); return (*this); }
+    String & operator += (const __FlashStringHelper *str) { concat(str); return (*this); }
+    String & operator += (char c) { concat(c); return (*this); }
+    String & operator += (unsigned char num) { concat(num); return (*this); }
+    String & operator += (int num) { concat(num); return (*this); }
+    String & operator += (unsigned int num) { concat(num); return (*this); }
+    String & operator += (long num) { concat(num); return (*this); }
+    String & operator += (unsigned long num) { concat(num); return (*this); }
+    String & operator += (float num) { concat(num); return (*this); }
+    String & operator += (double num) { concat(num); return (*this); }
+    friend String operator + (const String &lhs, const String &rhs);
+    friend String operator + (const String &lhs, const char *cstr);
+    friend String operator + (const String &lhs, const __FlashStringHelper *str);
+    friend String operator + (const char *cstr, const String &rhs);
+    friend String operator + (const String &lhs, char c);
+
+    // Comparison
+    unsigned char equals(const String &str) const;
+    unsigned char equals(const char *cstr) const;
+    unsigned char operator == (const String &rhs) const { return equals(rhs); }
+    unsigned char operator == (const char *cstr) const { return equals(cstr); }
+    unsigned char operator != (const String &rhs) const { return !equals(rhs); }
+    unsigned char operator != (const char *cstr) const { return !equals(cstr); }
+    unsigned char startsWith(const String &prefix) const;
+
+    // Character Access
+    char charAt(unsigned int index) const;
+    void setCharAt(unsigned int index, char c);
+    char operator [] (unsigned int index) const;
+    char & operator [] (unsigned int index);
+    const char * c_str(void) const { return buffer_ ? buffer_ : ""; }
+
+    // Search
+    int indexOf(char ch) const;
+    int indexOf(char ch, unsigned int from_index) const;
+    int indexOf(const String &str) const;
+    int indexOf(const String &str, unsigned int from_index) const;
+    int lastIndexOf(char ch) const;
+
+    // Modification
+    String substring(unsigned int begin_index) const { return substring(begin_index, len_); }
+    String substring(unsigned int begin_index, unsigned int end_index) const;
+    void trim(void);
+    void toUpperCase(void);
+
+    // Parsing
+    long toInt(void) const;
+    float toFloat(void) const;
+
+  private:
+    void invalidate(void);
+    unsigned char changeBuffer(unsigned int max_str_len);
+    unsigned char concat(const char *cstr, unsigned int length);
+    String & copy(const char *cstr, unsigned int length);
+
+    char *buffer_;
+    unsigned int capacity_;
+    unsigned int len_;
+    char dummy_writable_char_;
+};
+
+#endif // String_class_h
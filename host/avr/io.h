@@ -0,0 +1,16 @@
+/**
+ *  \file io.h
+ *  \brief Host stand-in for the AVR register definitions.
+ *  \details Only the registers referenced by the firmware are declared. Port registers
+ *  are laid out like AVR (PINx, DDRx, PORTx) in host_port_registers, see Arduino.h.
+ *  \author Jake Rye
+ */
+#ifndef HOST_AVR_IO_H
+#define HOST_AVR_IO_H
+
+#include <stdint.h>
+
+extern volatile uint8_t host_port_registers[];
+extern volatile uint8_t TWBR;
+
+#endif // HOST_AVR_IO_H
@@ -0,0 +1,21 @@
+/**
+ *  \file pgmspace.h
+ *  \brief Host stand-in for the AVR program memory utilities.
+ *  \details The host has a single address space so program memory is ordinary memory.
+ *  \author Jake Rye
+ */
+#ifndef HOST_AVR_PGMSPACE_H
+#define HOST_AVR_PGMSPACE_H
+
+#include <stdint.h>
+#include <string.h>
+
+#include "avr/io.h"
+
+#define PROGMEM
+#define PSTR(s) (s)
+#define PGM_P const char *
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define strlen_P(s) strlen(s)
+
+#endif // HOST_AVR_PGMSPACE_H
@@ -0,0 +1,243 @@
+/**
+ *  \file host_clock.cpp
+ *  \brief Deterministic virtual clock for the host build.
+ *  \details millis(), micros(), delay() and delayMicroseconds() run against simulated
+ *  time instead of the wall clock, so a simulated day runs in seconds. Waits advance
+ *  the clock instantly and every call that costs board time is recorded against the
+ *  function that made it (resolved from the return address), which gives an exact
+ *  account of where the loop spends its time on the board. The board's own clock can be
+ *  made to drift from simulated time, like a crystal off its nominal frequency, with
+ *  hostSetClockDrift(). Interrupts run at their due time within whatever wait or poll the
+ *  loop is in, or as soon as interrupts() is called when noInterrupts() held them off,
+ *  and the wait they broke into is longer by the time they took: a one shot timer
+ *  interrupt set with hostSetTimer(), and external interrupts set with attachInterrupt(),
+ *  due when a device on their pin changes its level (see HostPinDevice::nextChange()).
+ *  Like the AVR, an external interrupt held off over several changes runs once. See
+ *  host_hal.h.
+ *  \author Jake Rye
+ */
+#include "Arduino.h"
+
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <stdio.h>
+
+#include <map>
+#include <string>
+
+struct SiteKey {
+  const void *site;
+  const char *label;
+  HostTimeKind kind;
+  bool operator < (const SiteKey &other) const {
+    if (site != other.site) return site < other.site;
+    if (label != other.label) return label < other.label;
+    return kind < other.kind;
+  }
+};
+
+static uint64_t now_us_ = 0;
+static double clock_rate_ = 1; // board clock ticks per simulated microsecond
+static std::map<SiteKey, HostTimeRecord> records_;
+static SiteKey last_key_ = {NULL, NULL, kHostTimeWait};
+static HostTimeRecord *last_record_ = NULL; // spin loops hit the same site millions of times
+
+static const char *const kKindNames[] = {"wait", "poll", "io"};
+
+struct PinInterrupt {
+  void (*handler)(void);
+  uint64_t since_us; // changes of the pin up to then are handled
+};
+static const uint8_t kInterrupts = 6;
+static const uint8_t kInterruptPins[kInterrupts] = {2, 3, 21, 20, 19, 18};
+static const int kTimerInterrupt = kInterrupts; // source number of the timer
+static PinInterrupt pin_interrupts_[kInterrupts];
+static void (*timer_handler_)(void) = NULL;
+static uint64_t timer_due_us_ = 0;
+static bool interrupts_enabled_ = true;
+static bool in_interrupt_ = false;
+static HostInterruptStats interrupt_stats_ = {0, 0, 0, 0};
+
+//-------------------------------------------------PRIVATE-------------------------------------------//
+static bool isInterruptDue(uint64_t until_us, int &source, uint64_t &due_us) {
+  // Find The Earliest Interrupt Due Up To until_us
+  if (!interrupts_enabled_ || in_interrupt_) {
+    return false;
+  }
+  due_us = UINT64_MAX;
+  if (timer_handler_) {
+    due_us = timer_due_us_;
+    source = kTimerInterrupt;
+  }
+  for (uint8_t i = 0; i < kInterrupts; i++) {
+    if (pin_interrupts_[i].handler) {
+      uint64_t change_us = hostNextPinChange(kInterruptPins[i], pin_interrupts_[i].since_us);
+      if (change_us < due_us) {
+        due_us = change_us;
+        source = i;
+      }
+    }
+  }
+  return due_us <= until_us;
+}
+
+static void runInterrupt(int source, uint64_t due_us) {
+  // Interrupt When Due, Or Late If Interrupts Were Off
+  if (due_us > now_us_) {
+    now_us_ = due_us;
+  }
+  if (now_us_ - due_us > interrupt_stats_.max_latency_us) {
+    interrupt_stats_.max_latency_us = now_us_ - due_us;
+  }
+  void (*handler)(void);
+  const char *label;
+  if (source == kTimerInterrupt) {
+    handler = timer_handler_;
+    timer_handler_ = NULL; // one shot, the handler sets the next
+    label = "timer interrupt";
+    interrupt_stats_.timer_interrupts++;
+  }
+  else {
+    handler = pin_interrupts_[source].handler;
+    pin_interrupts_[source].since_us = now_us_;
+    label = "pin interrupt";
+    interrupt_stats_.pin_interrupts++;
+  }
+  uint64_t start = now_us_;
+  in_interrupt_ = true;
+  hostSpend(NULL, label, kHostTimeIo, HOST_COST_INTERRUPT_US);
+  handler();
+  in_interrupt_ = false;
+  interrupt_stats_.interrupt_us += now_us_ - start;
+}
+
+static std::string resolveSite(const void *site) {
+  Dl_info info;
+  if (dladdr(site, &info) && info.dli_sname) {
+    int status = 0;
+    char *demangled = abi::__cxa_demangle(info.dli_sname, NULL, NULL, &status);
+    std::string name = (status == 0) ? demangled : info.dli_sname;
+    free(demangled);
+    return name;
+  }
+  char buffer[32];
+  snprintf(buffer, sizeof(buffer), "%p", site);
+  return buffer;
+}
+
+//-------------------------------------------------ARDUINO-------------------------------------------//
+unsigned long millis(void) {
+  hostSpend(__builtin_return_address(0), NULL, kHostTimePoll, HOST_COST_TIMER_US);
+  return (uint64_t)(now_us_ * clock_rate_) / 1000;
+}
+
+unsigned long micros(void) {
+  hostSpend(__builtin_return_address(0), NULL, kHostTimePoll, HOST_COST_TIMER_US);
+  return (uint64_t)(now_us_ * clock_rate_);
+}
+
+void delay(unsigned long ms) {
+  hostSpend(__builtin_return_address(0), NULL, kHostTimeWait, (uint64_t)ms * 1000);
+}
+
+void delayMicroseconds(unsigned int us) {
+  hostSpend(__builtin_return_address(0), NULL, kHostTimeWait, us);
+}
+
+void interrupts(void) {
+  interrupts_enabled_ = true;
+  int source;
+  uint64_t due_us;
+  while (isInterruptDue(now_us_, source, due_us)) {
+    runInterrupt(source, due_us);
+  }
+}
+
+void noInterrupts(void) {
+  interrupts_enabled_ = false;
+}
+
+void attachInterrupt(uint8_t interrupt, void (*handler)(void), int mode) {
+  // Every Change Interrupts, Like CHANGE
+  if (interrupt < kInterrupts) {
+    pin_interrupts_[interrupt].handler = handler;
+    pin_interrupts_[interrupt].since_us = now_us_;
+  }
+}
+
+void detachInterrupt(uint8_t interrupt) {
+  if (interrupt < kInterrupts) {
+    pin_interrupts_[interrupt].handler = NULL;
+  }
+}
+
+//-------------------------------------------------HOST----------------------------------------------//
+uint64_t hostNow(void) {
+  return now_us_;
+}
+
+void hostSetClockDrift(double ppm) {
+  clock_rate_ = 1 + ppm / 1000000;
+}
+
+void hostSpend(const void *site, const char *label, HostTimeKind kind, uint64_t us) {
+  // Run Interrupts Due Within The Time Spent, Which They Lengthen
+  uint64_t end = now_us_ + us;
+  int source;
+  uint64_t due_us;
+  while (isInterruptDue(end, source, due_us)) {
+    uint64_t start = (due_us > now_us_) ? due_us : now_us_;
+    runInterrupt(source, due_us);
+    end += now_us_ - start;
+  }
+  now_us_ = end;
+  SiteKey key = {label ? NULL : site, label, kind};
+  if (!last_record_ || key < last_key_ || last_key_ < key) {
+    last_key_ = key;
+    last_record_ = &records_[key];
+  }
+  last_record_->calls++;
+  last_record_->total_us += us;
+  if (us > last_record_->max_us) {
+    last_record_->max_us = us;
+  }
+}
+
+void hostSetTimer(uint32_t us, void (*handler)(void)) {
+  timer_due_us_ = now_us_ + us;
+  timer_handler_ = handler;
+}
+
+void hostCancelTimer(void) {
+  timer_handler_ = NULL;
+}
+
+HostInterruptStats hostInterruptStats(void) {
+  return interrupt_stats_;
+}
+
+std::vector<HostTimeRecord> hostTimeRecords(void) {
+  // Merge Sites Belonging To The Same Function
+  std::map<std::pair<std::string, int>, HostTimeRecord> merged;
+  for (std::map<SiteKey, HostTimeRecord>::const_iterator it = records_.begin(); it != records_.end(); ++it) {
+    std::string name = it->first.label ? it->first.label : resolveSite(it->first.site);
+    HostTimeRecord &record = merged[std::make_pair(name, (int)it->first.kind)];
+    record.name = name;
+    record.kind = kKindNames[it->first.kind];
+    record.calls += it->second.calls;
+    record.total_us += it->second.total_us;
+    if (it->second.max_us > record.max_us) {
+      record.max_us = it->second.max_us;
+    }
+  }
+  std::vector<HostTimeRecord> records;
+  for (std::map<std::pair<std::string, int>, HostTimeRecord>::const_iterator it = merged.begin(); it != merged.end(); ++it) {
+    records.push_back(it->second);
+  }
+  return records;
+}
+
+void hostClearTimeRecords(void) {
+  records_.clear();
+  last_record_ = NULL;
+}
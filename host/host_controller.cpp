@@ -0,0 +1,421 @@
+/**
+ *  \file host_controller.cpp
+ *  \brief Simulated controller (rPi) on the other end of the serial line.
+ *  \details See host_controller.h for details.
+ *  \author Jake Rye
+ */
+#include "host_controller.h"
+
+#include <stdio.h>
+
+#include "support_history.h"
+#include "support_message.h"
+
+#define SOH 1
+#define STX 2
+#define ETX 3
+#define EOT 4
+#define ENQ 5
+#define ACK 6
+#define DC1 17
+#define NAK 21
+
+#define HANDSHAKE_BAUD 9600
+#define BAUD_CONFIRM_US 100000 // an offered rate not confirmed within this long is dropped
+
+//--------------------------------------------------PUBLIC-------------------------------------------//
+HostController::HostController(void) {
+  acknowledge_enquiry = true;
+  max_baud = 115200;
+  baud_ = HANDSHAKE_BAUD;
+  baud_switch_us_ = 0;
+  echo = false;
+  frames = 0;
+  bad_frames = 0;
+  frame_bytes = 0;
+  streams = 0;
+  instruction_us = 0;
+  frame_size_ = -1;
+  frame_text_ = 0;
+  indexed_ = false;
+  time_syncs = 0;
+  time_offset_ms = 0;
+  max_time_offset_ms = 0;
+  time_drift_ppm = 0;
+  history_frames = 0;
+  history_records = 0;
+  history_bytes = 0;
+  history_first_us = 0;
+  history_last_us = 0;
+  rollup_frames = 0;
+  rollup_summaries = 0;
+  rollup_bytes = 0;
+}
+
+void HostController::onBoardByte(uint8_t c) {
+  if (c == ENQ && buffer_.empty()) {
+    if (acknowledge_enquiry) {
+      uint8_t ack = ACK;
+      hostSerialInject(&ack, 1);
+      baud_switch_us_ = 0; // enquiry got through, rate confirmed
+    }
+    return;
+  }
+  if (c == ACK && buffer_.empty()) {
+    return; // board acknowledged our acknowledgement
+  }
+  buffer_ += (char)c;
+  if (buffer_[0] == SOH) { // SOH<size>STX<message>ETX<checksum>EOT, message may be binary
+    if (c == STX && frame_size_ < 0) {
+      frame_size_ = atol(buffer_.c_str() + 1);
+      frame_text_ = buffer_.length();
+    }
+    else if (c == EOT && frame_size_ >= 0 && buffer_.length() > frame_text_ + frame_size_ + 1) {
+      handleFrame();
+      buffer_.clear();
+      frame_size_ = -1;
+    }
+  }
+  else if (c == EOT && buffer_[0] == DC1) {
+    handleBaudOffer();
+    buffer_.clear();
+  }
+  else if (c == '\n' && buffer_[0] != SOH && buffer_[0] != DC1) { // not connected, board prints lines
+    handleMessage(buffer_);
+    if (echo) {
+      printf("%s", buffer_.c_str());
+    }
+    buffer_.clear();
+  }
+}
+
+unsigned long HostController::baud(void) {
+  // Fall Back To The Handshake Rate If The Board Never Confirmed The New One
+  if (baud_switch_us_ && hostNow() - baud_switch_us_ > BAUD_CONFIRM_US) {
+    baud_ = HANDSHAKE_BAUD;
+    baud_switch_us_ = 0;
+    buffer_.clear();
+  }
+  return baud_;
+}
+
+void HostController::sendInstruction(const std::string &instruction) {
+  std::string frame;
+  frame += (char)SOH;
+  frame += std::to_string(instruction.length());
+  frame += (char)STX;
+  frame += instruction;
+  frame += (char)ETX;
+  frame += std::to_string(checksum(instruction));
+  frame += (char)EOT;
+  hostSerialInject((const uint8_t *)frame.data(), frame.length());
+  instruction_us = hostNow();
+}
+
+void HostController::syncTime(void) {
+  uint64_t now_ms = hostNow() / 1000;
+  sendInstruction("GTIM 1 " + std::to_string(HOST_EPOCH_S + now_ms / 1000) + " " + std::to_string(now_ms % 1000));
+}
+
+std::vector<std::string> HostController::takeMessages(void) {
+  std::vector<std::string> messages;
+  messages.swap(messages_);
+  return messages;
+}
+
+uint8_t HostController::checksum(const std::string &message) {
+  uint8_t crc = 0x00;
+  for (size_t i = 0; i < message.length(); i++) {
+    uint8_t extract = message[i];
+    for (uint8_t bit = 8; bit; bit--) {
+      uint8_t sum = (crc ^ extract) & 0x01;
+      crc >>= 1;
+      if (sum) {
+        crc ^= 0x8C;
+      }
+      extract >>= 1;
+    }
+  }
+  return crc;
+}
+
+//-------------------------------------------------PRIVATE-------------------------------------------//
+void HostController::handleFrame(void) {
+  frame_bytes = buffer_.length();
+  size_t etx = frame_text_ + frame_size_;
+  if (buffer_[etx] != ETX) {
+    bad_frames++;
+    return;
+  }
+  std::string message = buffer_.substr(frame_text_, frame_size_);
+  int crc = atoi(buffer_.substr(etx + 1, buffer_.length() - etx - 2).c_str());
+  if (crc != checksum(message)) {
+    bad_frames++;
+    return;
+  }
+  frames++;
+  if (!message.empty() && (uint8_t)message[0] == kBinaryStream) {
+    message = decodeBinaryStream(message);
+  }
+  else if (!message.empty() && (uint8_t)message[0] == kHistoryFrame) {
+    history_frames++;
+    history_bytes += frame_bytes;
+    history_first_us = history_first_us ? history_first_us : hostNow();
+    history_last_us = hostNow();
+    message = decodeHistoryFrame(message);
+  }
+  else if (!message.empty() && (uint8_t)message[0] == kRollupFrame) {
+    rollup_frames++;
+    rollup_bytes += frame_bytes;
+    message = decodeRollupFrame(message);
+  }
+  else if (indexed_ && message.find("\"GTYP\":\"Stream\"") != std::string::npos) {
+    message = expandKeys(message);
+  }
+  handleMessage(message);
+  if (echo) {
+    printf("%s\n", message.c_str());
+  }
+}
+
+void HostController::handleBaudOffer(void) {
+  // DC1<baud rate>EOT, Accept With ACK & Switch Or Refuse With NAK
+  if (!max_baud) {
+    return; // controller predates rate negotiation
+  }
+  unsigned long offer = strtoul(buffer_.c_str() + 1, NULL, 10);
+  uint8_t reply = (offer && offer <= max_baud) ? ACK : NAK;
+  hostSerialInject(&reply, 1);
+  if (reply == ACK) {
+    baud_ = offer;
+    baud_switch_us_ = hostNow();
+  }
+}
+
+std::string HostController::decodeBinaryStream(const std::string &message) {
+  // Decode Records Into The JSON The Board Would Have Sent
+  std::string json = "{\"GTYP\":\"Stream\",";
+  const uint8_t *data = (const uint8_t *)message.data();
+  size_t i = 1;
+  while (i < message.length()) {
+    // Key Record: Key Number & Value, Precision From The Dictionary
+    uint8_t type = data[i] >> 6;
+    uint8_t index = data[i++] & 0x3F;
+    if (indexed_ && index != kKeyRecordFull) {
+      const DictionaryKey &key = keys_.at(index);
+      json += "\"" + key.code + " " + std::to_string(key.id) + "\":";
+      if (type == kKeyRecordFalse || type == kKeyRecordTrue) {
+        json += (type == kKeyRecordTrue) ? "1," : "0,";
+      }
+      else {
+        json += decodeValue(data, i, type == kKeyRecordInt16 ? 2 : 4, key.decimals);
+      }
+      continue;
+    }
+    if (indexed_) { // full record follows
+      type = data[i] >> 6;
+      index = data[i++] & 0x3F;
+    }
+
+    // Full Record: Code, ID & Value
+    std::string code = "????";
+    if (index == kRecordInlineCode) {
+      code = message.substr(i, 4);
+      i += 4;
+    }
+    else if (index < codes_.size()) {
+      code = codes_[index];
+    }
+    uint8_t flags = data[i] >> 6;
+    int id = data[i++] & 0x3F;
+    json += "\"" + code + " " + std::to_string(id) + "\":";
+    if (type == kRecordText) {
+      uint8_t length = data[i++];
+      json += "\"" + message.substr(i, length) + "\",";
+      i += length;
+    }
+    else if (type == kRecordBoolean) {
+      json += std::to_string(flags) + ",";
+    }
+    else {
+      json += decodeValue(data, i, type == kRecordInt16 ? 2 : 4, flags);
+    }
+  }
+  json += "\"GEND\":0},";
+  return json;
+}
+
+std::string HostController::decodeValue(const uint8_t *data, size_t &i, int size, uint8_t decimals) {
+  // Little Endian Fixed Point
+  uint32_t raw = 0;
+  for (int b = 0; b < size; b++) {
+    raw |= (uint32_t)data[i++] << (8 * b);
+  }
+  long value = (size == 2) ? (long)(int16_t)raw : (long)(int32_t)raw;
+  double scale = 1;
+  for (uint8_t d = 0; d < decimals; d++) {
+    scale *= 10;
+  }
+  char text[24];
+  snprintf(text, sizeof(text), "%.*f,", decimals, value / scale);
+  return text;
+}
+
+std::string HostController::decodeHistoryFrame(const std::string &message) {
+  // Header: Controller Time Of The First Record
+  const uint8_t *data = (const uint8_t *)message.data();
+  size_t i = 1;
+  uint64_t time_ms = 0;
+  for (int b = 0; b < 4; b++) {
+    time_ms |= (uint64_t)data[i++] << (8 * b);
+  }
+  time_ms = time_ms * 1000 + (data[i] | (data[i + 1] << 8));
+  i += 2;
+
+  // Records: Key, Time Since Previous Record & 24 Bit Value
+  std::string json = "{\"GTYP\":\"History\",\"records\":[";
+  for (int n = 0; i + kHistoryRecordSize <= message.length(); n++) {
+    uint8_t decimals = data[i] >> 6;
+    uint8_t index = data[i++] & 0x3F;
+    uint32_t difference = data[i] | (data[i + 1] << 8);
+    i += 2;
+    if (difference >= kHistoryLongTime) { // high 15 bits, low 16 bits follow
+      difference = ((difference & 0x7FFF) << 16) | data[i] | (data[i + 1] << 8);
+      i += 2;
+    }
+    time_ms += difference;
+    history_records++;
+    int32_t raw = (int32_t)((uint32_t)(data[i] | (data[i + 1] << 8) | (data[i + 2] << 16)) << 8) >> 8;
+    i += 3;
+    uint8_t value[4] = {(uint8_t)raw, (uint8_t)(raw >> 8), (uint8_t)(raw >> 16), (uint8_t)(raw >> 24)};
+    size_t position = 0;
+    std::string text = decodeValue(value, position, 4, decimals);
+    std::string key = "#" + std::to_string(index);
+    if (index < keys_.size()) {
+      key = keys_[index].code + " " + std::to_string(keys_[index].id);
+    }
+    char time[32];
+    snprintf(time, sizeof(time), "%llu.%03llu", (unsigned long long)(time_ms / 1000),
+             (unsigned long long)(time_ms % 1000));
+    json += std::string(n ? ",[" : "[") + time + ",\"" + key + "\"," + text.substr(0, text.length() - 1) + "]";
+  }
+  json += "]},";
+  return json;
+}
+
+std::string HostController::decodeRollupFrame(const std::string &message) {
+  // Header: Period, Time Of First Row, Rows, Keys & Key Bytes
+  const uint8_t *data = (const uint8_t *)message.data();
+  uint16_t period = data[1] | (data[2] << 8);
+  uint32_t start = data[3] | (data[4] << 8) | (data[5] << 16) | ((uint32_t)data[6] << 24);
+  uint8_t rows = data[7];
+  uint8_t key_count = data[8];
+  const uint8_t *key_bytes = data + kRollupHeaderSize;
+  size_t i = kRollupHeaderSize + key_count;
+
+  // Rows: Min, Max, Mean & Count Per Key, Scaled By 10^(Bits 15-14 Of Count)
+  std::string json = "{\"GTYP\":\"Rollup\",\"period\":" + std::to_string(period) + ",\"rows\":[";
+  bool first = true;
+  for (uint8_t row = 0; row < rows; row++) {
+    for (uint8_t k = 0; k < key_count && i + kRollupSummarySize <= message.length(); k++) {
+      int16_t fields[3];
+      for (int f = 0; f < 3; f++, i += 2) {
+        fields[f] = (int16_t)(data[i] | (data[i + 1] << 8));
+      }
+      uint16_t count = data[i] | (data[i + 1] << 8);
+      i += 2;
+      rollup_summaries++;
+      uint8_t decimals = key_bytes[k] >> 6;
+      double scale = pow(10, (count >> 14) - (int)decimals);
+      uint8_t index = key_bytes[k] & 0x3F;
+      std::string key = "#" + std::to_string(index);
+      if (index < keys_.size()) {
+        key = keys_[index].code + " " + std::to_string(keys_[index].id);
+      }
+      char text[128];
+      snprintf(text, sizeof(text), "%s[%u,\"%s\",%.*f,%.*f,%.*f,%u]", first ? "" : ",",
+               (unsigned)(start + row * period), key.c_str(), decimals, fields[0] * scale, decimals,
+               fields[1] * scale, decimals, fields[2] * scale, count & 0x3FFF);
+      json += text;
+      first = false;
+    }
+  }
+  json += "]},";
+  return json;
+}
+
+std::string HostController::expandKeys(const std::string &message) {
+  // Replace "<key number>": With "<code> <id>":
+  std::string json;
+  size_t i = 0;
+  while (i < message.length()) {
+    size_t end = message.find("\":", i + 1);
+    if (message[i] == '"' && end != std::string::npos && end > i + 1 &&
+        message.find_first_not_of("0123456789", i + 1) == end) {
+      const DictionaryKey &key = keys_.at(atoi(message.c_str() + i + 1));
+      json += "\"" + key.code + " " + std::to_string(key.id);
+      i = end;
+    }
+    json += message[i++];
+  }
+  return json;
+}
+
+void HostController::learnDictionary(const std::string &message) {
+  // "GDSC 1":{"mode":1,"keys":[["AACR",1,"bool",0],...]}
+  const std::string header = "\"GDSC 1\":{\"mode\":";
+  size_t start = message.find(header);
+  if (start == std::string::npos) {
+    return;
+  }
+  indexed_ = message[start + header.length()] == '1';
+  keys_.clear();
+  size_t end = message.find("]]", start);
+  for (size_t i = message.find("[\"", start); i < end; i = message.find("[\"", i + 1)) {
+    DictionaryKey key;
+    key.code = message.substr(i + 2, 4);
+    key.id = atoi(message.c_str() + i + 8);
+    key.decimals = atoi(message.c_str() + message.find(']', i) - 1);
+    keys_.push_back(key);
+  }
+}
+
+void HostController::learnTime(const std::string &message) {
+  // "GTIM 1":{"syncs":4,"offset":-3,"drift":41.5,"status":2}
+  size_t start = message.find("\"GTIM 1\":{");
+  if (start == std::string::npos) {
+    return;
+  }
+  time_syncs = atol(message.c_str() + message.find("\"syncs\":", start) + 8);
+  time_offset_ms = atol(message.c_str() + message.find("\"offset\":", start) + 9);
+  time_drift_ppm = atof(message.c_str() + message.find("\"drift\":", start) + 8);
+  if (time_syncs >= 3 && labs(time_offset_ms) > labs(max_time_offset_ms)) {
+    max_time_offset_ms = time_offset_ms;
+  }
+}
+
+void HostController::learnCodes(const std::string &message) {
+  // "codes":["AACR","AAHE",...]
+  size_t start = message.find("\"codes\":[");
+  if (start == std::string::npos) {
+    return;
+  }
+  codes_.clear();
+  size_t end = message.find(']', start);
+  for (size_t i = message.find('"', start + 9); i < end; i = message.find('"', i + 6)) {
+    codes_.push_back(message.substr(i + 1, 4));
+  }
+}
+
+void HostController::handleMessage(const std::string &message) {
+  learnCodes(message);
+  learnDictionary(message);
+  learnTime(message);
+  if (message.find("\"GTYP\":\"Stream\"") != std::string::npos) {
+    streams++;
+  }
+  else if (message.find("\"GTYP\":\"Response\"") != std::string::npos) {
+    response_latencies_us.push_back(hostNow() - instruction_us);
+  }
+  messages_.push_back(message);
+}
@@ -0,0 +1,115 @@
+/**
+ *  \file host_controller.h
+ *  \brief Simulated controller (rPi) on the other end of the serial line.
+ *  \details Acknowledges the ENQ handshake sent by Communication::begin(), accepts
+ *  the baud rates the board offers up to max_baud (see communication.h), sends
+ *  instructions packed in the SOH<size>STX<message>ETX<checksum>EOT format and
+ *  unpacks every frame the board sends so that message sizes can be measured. Frames are
+ *  read by the size in their header, so binary messages may contain control characters.
+ *  Binary streams are decoded back to JSON with the codes listed in the GFMT response, and
+ *  key numbers are replaced by the keys of the dictionary in the GDSC response.
+ *  The controller's clock is simulated time from HOST_EPOCH_S (unix time), sent to the
+ *  board with syncTime(). The offset and drift of the board clock are read from the
+ *  GTIM responses. History frames (see support_history.h) are decoded to
+ *  {"GTYP":"History","records":[[<unix time>,"<code> <id>",<value>],...]} and rollup frames
+ *  to {"GTYP":"Rollup","period":<s>,"rows":[[<unix time>,"<code> <id>",<min>,<max>,<mean>,<count>],...]}.
+ *  \author Jake Rye
+ */
+#ifndef HOST_CONTROLLER_H
+#define HOST_CONTROLLER_H
+
+#include <string>
+#include <vector>
+
+#include "Arduino.h"
+
+#define HOST_EPOCH_S 1760000000 // unix time of the controller at the start of the simulation
+
+/**
+ * \brief Simulated controller (rPi) on the other end of the serial line.
+ */
+class HostController : public HostSerialPeer {
+  public:
+    HostController(void);
+
+    /**
+     * \brief Handles a byte sent by the board.
+     */
+    void onBoardByte(uint8_t c);
+
+    /**
+     * \brief Returns the baud rate of the controller's uart.
+     * Goes back to the handshake rate once an accepted rate is overdue for confirmation.
+     */
+    unsigned long baud(void);
+
+    /**
+     * \brief Packs instruction (e.g. "AAHE 1 1") into a frame and sends it to the board.
+     */
+    void sendInstruction(const std::string &instruction);
+
+    /**
+     * \brief Sends the controller time to the board: GTIM 1 <unix seconds> <milliseconds>
+     */
+    void syncTime(void);
+
+    /**
+     * \brief Returns the messages received since the last call and clears them.
+     */
+    std::vector<std::string> takeMessages(void);
+
+    static uint8_t checksum(const std::string &message);
+
+    // Public Variables
+    bool acknowledge_enquiry; // answer ENQ with ACK
+    unsigned long max_baud; // highest baud rate accepted from the board, 0 to ignore offers
+    bool echo; // print every received message to stdout
+    uint32_t frames; // valid frames received
+    uint32_t bad_frames; // frames with bad size or checksum
+    uint32_t frame_bytes; // bytes of the last frame, including framing
+    uint32_t streams; // stream messages received
+    uint64_t instruction_us; // board time the last instruction was sent
+    std::vector<uint64_t> response_latencies_us; // instruction to response, one per response
+    uint32_t time_syncs; // GTIM responses received
+    long time_offset_ms; // board clock ahead of the controller at the last sync
+    long max_time_offset_ms; // largest offset once the drift has been learned, from the third sync
+    double time_drift_ppm; // drift of the board clock learned by the board
+    uint32_t history_frames; // history frames received
+    uint32_t history_records; // records in them
+    uint32_t history_bytes; // bytes of the history frames, including framing
+    uint64_t history_first_us; // board time the first history frame arrived
+    uint64_t history_last_us; // board time the last history frame arrived
+    uint32_t rollup_frames; // rollup frames received
+    uint32_t rollup_summaries; // summaries of a key in them, empty buckets included
+    uint32_t rollup_bytes; // bytes of the rollup frames, including framing
+
+  private:
+    void handleFrame(void);
+    std::string decodeBinaryStream(const std::string &message);
+    std::string decodeValue(const uint8_t *data, size_t &i, int size, uint8_t decimals);
+    std::string decodeHistoryFrame(const std::string &message);
+    std::string decodeRollupFrame(const std::string &message);
+    std::string expandKeys(const std::string &message);
+    void learnCodes(const std::string &message);
+    void learnDictionary(const std::string &message);
+    void learnTime(const std::string &message);
+    void handleBaudOffer(void);
+    void handleMessage(const std::string &message);
+
+    unsigned long baud_;
+    uint64_t baud_switch_us_; // when baud_ was switched to an unconfirmed rate, 0 once confirmed
+    std::string buffer_;
+    long frame_size_; // from the header of the frame in buffer_, -1 until its STX
+    size_t frame_text_; // index of the message in buffer_
+    std::vector<std::string> codes_; // binary record code numbers, from GFMT
+    struct DictionaryKey {
+      std::string code;
+      int id;
+      uint8_t decimals;
+    };
+    std::vector<DictionaryKey> keys_; // key numbers, from GDSC
+    bool indexed_; // board sends key numbers
+    std::vector<std::string> messages_;
+};
+
+#endif // HOST_CONTROLLER_H
@@ -0,0 +1,353 @@
+/**
+ *  \file host_devices.cpp
+ *  \brief Simulated devices attached to pins in the host build.
+ *  \details See host_devices.h for details.
+ *  \author Jake Rye
+ */
+#include "host_devices.h"
+
+#include <string.h>
+
+#define DHT22_MIN_START_LOW_US 1000
+#define DHT22_RESPONSE_DELAY_US 30
+#define DHT22_PREAMBLE_LOW_US 80
+#define DHT22_PREAMBLE_HIGH_US 80
+#define DHT22_BIT_LOW_US 50
+#define DHT22_ZERO_HIGH_US 26
+#define DHT22_ONE_HIGH_US 70
+#define ONE_WIRE_RESET_US 480
+#define ONE_WIRE_ONE_US 30 // shorter lows write a 1
+#define ONE_WIRE_PRESENCE_DELAY_US 30
+#define ONE_WIRE_PRESENCE_US 120
+#define ONE_WIRE_ZERO_US 40 // low held by a device sending a 0
+
+//-------------------------------------------------DHT22---------------------------------------------//
+HostDht22::HostDht22(float temperature_offset, float humidity_offset) {
+  this->temperature_offset = temperature_offset;
+  this->humidity_offset = humidity_offset;
+  timing_percent = 100;
+  transfers = 0;
+  low_since_us_ = 0;
+  transfer_start_us_ = 0;
+  transferring_ = false;
+}
+
+void HostDht22::onBoardDrive(uint8_t pin, bool low, uint64_t now_us) {
+  if (low) {
+    low_since_us_ = now_us;
+    transferring_ = false;
+    return;
+  }
+  if (now_us - low_since_us_ >= DHT22_MIN_START_LOW_US) {
+    loadData();
+    transfer_start_us_ = now_us + DHT22_RESPONSE_DELAY_US;
+    transferring_ = true;
+    transfers++;
+  }
+}
+
+bool HostDht22::pullsLow(uint8_t pin, uint64_t now_us) {
+  if (!transferring_ || now_us < transfer_start_us_) {
+    return false;
+  }
+  uint64_t t = now_us - transfer_start_us_;
+
+  // Preamble
+  if (t < scaled(DHT22_PREAMBLE_LOW_US)) {
+    return true;
+  }
+  t -= scaled(DHT22_PREAMBLE_LOW_US);
+  if (t < scaled(DHT22_PREAMBLE_HIGH_US)) {
+    return false;
+  }
+  t -= scaled(DHT22_PREAMBLE_HIGH_US);
+
+  // Data Bits, Most Significant First, Then A Final Low Before Releasing The Line
+  for (uint8_t i = 0; i <= 40; i++) {
+    if (t < scaled(DHT22_BIT_LOW_US)) {
+      return true;
+    }
+    t -= scaled(DHT22_BIT_LOW_US);
+    if (i == 40) {
+      break;
+    }
+    bool one = data_[i / 8] & (0x80 >> (i % 8));
+    uint64_t high_us = one ? scaled(DHT22_ONE_HIGH_US) : scaled(DHT22_ZERO_HIGH_US);
+    if (t < high_us) {
+      return false;
+    }
+    t -= high_us;
+  }
+  transferring_ = false;
+  return false;
+}
+
+uint64_t HostDht22::nextChange(uint8_t pin, uint64_t now_us) {
+  if (!transferring_) {
+    return UINT64_MAX;
+  }
+
+  // Edges Of The Preamble, Then Of Each Bit & The Final Low
+  uint64_t edge_us = transfer_start_us_;
+  if (edge_us > now_us) {
+    return edge_us;
+  }
+  edge_us += scaled(DHT22_PREAMBLE_LOW_US);
+  if (edge_us > now_us) {
+    return edge_us;
+  }
+  edge_us += scaled(DHT22_PREAMBLE_HIGH_US);
+  for (uint8_t i = 0; i <= 40; i++) {
+    if (edge_us > now_us) {
+      return edge_us;
+    }
+    edge_us += scaled(DHT22_BIT_LOW_US);
+    if (edge_us > now_us) {
+      return edge_us;
+    }
+    if (i < 40) {
+      bool one = data_[i / 8] & (0x80 >> (i % 8));
+      edge_us += one ? scaled(DHT22_ONE_HIGH_US) : scaled(DHT22_ZERO_HIGH_US);
+    }
+  }
+  return UINT64_MAX;
+}
+
+uint64_t HostDht22::scaled(uint64_t us) {
+  return us * timing_percent / 100;
+}
+
+void HostDht22::loadData(void) {
+  uint16_t humidity = (uint16_t)lround((host_environment.air_humidity + humidity_offset) * 10);
+  int16_t temperature = (int16_t)lround((host_environment.air_temperature + temperature_offset) * 10);
+  uint16_t temperature_bits = (temperature < 0) ? (0x8000 | -temperature) : temperature;
+  data_[0] = humidity >> 8;
+  data_[1] = humidity & 0xFF;
+  data_[2] = temperature_bits >> 8;
+  data_[3] = temperature_bits & 0xFF;
+  data_[4] = data_[0] + data_[1] + data_[2] + data_[3];
+}
+
+//------------------------------------------------DS18B20--------------------------------------------//
+static uint8_t oneWireCrc8(const uint8_t *data, uint8_t length) {
+  uint8_t crc = 0;
+  while (length--) {
+    uint8_t byte = *data++;
+    for (uint8_t i = 0; i < 8; i++) {
+      uint8_t mix = (crc ^ byte) & 0x01;
+      crc >>= 1;
+      if (mix) {
+        crc ^= 0x8C;
+      }
+      byte >>= 1;
+    }
+  }
+  return crc;
+}
+
+HostDs18b20::HostDs18b20(uint64_t serial, float temperature_offset) {
+  rom[0] = 0x28;
+  for (uint8_t i = 1; i < 7; i++) {
+    rom[i] = serial >> (8 * (i - 1));
+  }
+  rom[7] = oneWireCrc8(rom, 7);
+  offset = temperature_offset;
+  error_interval = 0;
+  searches = 0;
+  reads = 0;
+  conversions = 0;
+  state_ = kIdle;
+  fall_us_ = 0;
+  low_until_us_ = 0;
+  conversion_end_us_ = 0;
+  converting_ = false;
+  sending_ = false;
+  length_ = 0;
+  position_ = 0;
+  uint8_t power_on[8] = {0x50, 0x05, 0x4B, 0x46, 0x7F, 0xFF, 0x0C, 0x10}; // 85 C, 12 bits
+  memcpy(scratchpad_, power_on, 8);
+  scratchpad_[8] = oneWireCrc8(scratchpad_, 8);
+}
+
+void HostDs18b20::onBoardDrive(bool low, uint64_t now_us) {
+  finishConversion(now_us);
+
+  // Falling Edge Starts A Slot, Sending A Bit If The Sensor Has One
+  if (low) {
+    fall_us_ = now_us;
+    bool bit = true;
+    sending_ = true;
+    if (state_ == kSend) {
+      bit = buffer_[position_ / 8] & (1 << (position_ % 8));
+      if (++position_ == length_ * 8) {
+        state_ = kIdle;
+      }
+    }
+    else if ((state_ == kSearchRom) && (search_step_ < 2)) {
+      bit = rom[search_bit_ / 8] & (1 << (search_bit_ % 8));
+      bit = (search_step_ == 0) ? bit : !bit;
+      search_step_++;
+    }
+    else if (state_ == kConvert) {
+      bit = !converting_;
+    }
+    else {
+      sending_ = false;
+    }
+    low_until_us_ = bit ? now_us : now_us + ONE_WIRE_ZERO_US;
+    return;
+  }
+
+  // Rising Edge Ends A Reset Or Writes A Bit
+  uint64_t low_us = now_us - fall_us_;
+  if (low_us >= ONE_WIRE_RESET_US) {
+    state_ = kRomCommand;
+    sending_ = false;
+    bit_count_ = 0;
+    byte_ = 0;
+    fall_us_ = now_us + ONE_WIRE_PRESENCE_DELAY_US; // presence pulse
+    low_until_us_ = fall_us_ + ONE_WIRE_PRESENCE_US;
+    return;
+  }
+  if (sending_) { // the board released a read slot
+    return;
+  }
+  receiveBit(low_us < ONE_WIRE_ONE_US, now_us);
+}
+
+bool HostDs18b20::pullsLow(uint64_t now_us) {
+  return (now_us >= fall_us_) && (now_us < low_until_us_);
+}
+
+void HostDs18b20::receiveBit(bool bit, uint64_t now_us) {
+  // Search ROM: Drop Out Unless The Board Follows The Bit Of This Sensor
+  if (state_ == kSearchRom) {
+    bool own = rom[search_bit_ / 8] & (1 << (search_bit_ % 8));
+    search_step_ = 0;
+    if ((bit != own) || (++search_bit_ == 64)) {
+      state_ = kIdle;
+    }
+    return;
+  }
+  if ((state_ != kRomCommand) && (state_ != kMatchRom) && (state_ != kFunctionCommand) &&
+      (state_ != kReceive)) {
+    return;
+  }
+
+  // Other States Receive Bytes, Least Significant Bit First
+  byte_ |= bit << bit_count_;
+  if (++bit_count_ == 8) {
+    uint8_t byte = byte_;
+    bit_count_ = 0;
+    byte_ = 0;
+    receiveByte(byte, now_us);
+  }
+}
+
+void HostDs18b20::receiveByte(uint8_t byte, uint64_t now_us) {
+  switch (state_) {
+    case kRomCommand:
+      if (byte == 0x33) { // read rom
+        send(rom, 8);
+      }
+      else if (byte == 0x55) { // match rom
+        state_ = kMatchRom;
+        length_ = 0;
+      }
+      else if (byte == 0xCC) { // skip rom
+        state_ = kFunctionCommand;
+      }
+      else if (byte == 0xF0) { // search rom
+        state_ = kSearchRom;
+        search_bit_ = 0;
+        search_step_ = 0;
+        searches++;
+      }
+      else {
+        state_ = kIdle;
+      }
+      break;
+    case kMatchRom:
+      buffer_[length_++] = byte;
+      if (length_ == 8) {
+        state_ = memcmp(buffer_, rom, 8) ? kIdle : kFunctionCommand;
+      }
+      break;
+    case kFunctionCommand:
+      if (byte == 0x44) { // convert t
+        static const uint16_t kConversionMs[4] = {94, 188, 375, 750};
+        conversion_end_us_ = now_us + kConversionMs[(scratchpad_[4] >> 5) & 0x03] * 1000ULL;
+        converting_ = true;
+        conversions++;
+        state_ = kConvert;
+      }
+      else if (byte == 0xBE) { // read scratchpad
+        reads++;
+        send(scratchpad_, 9);
+        if (error_interval && (reads % error_interval == 0)) {
+          buffer_[reads % 8] ^= 0x04;
+        }
+      }
+      else if (byte == 0x4E) { // write scratchpad: th, tl & configuration
+        state_ = kReceive;
+        length_ = 0;
+      }
+      else {
+        state_ = kIdle;
+      }
+      break;
+    case kReceive:
+      buffer_[length_++] = byte;
+      if (length_ == 3) {
+        scratchpad_[2] = buffer_[0];
+        scratchpad_[3] = buffer_[1];
+        scratchpad_[4] = (buffer_[2] & 0x60) | 0x1F;
+        scratchpad_[8] = oneWireCrc8(scratchpad_, 8);
+        state_ = kIdle;
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+void HostDs18b20::send(const uint8_t *data, uint8_t length) {
+  memcpy(buffer_, data, length);
+  length_ = length;
+  position_ = 0;
+  state_ = kSend;
+}
+
+void HostDs18b20::finishConversion(uint64_t now_us) {
+  // Load Temperature At The Resolution Set, Undefined Low Bits Read As 0
+  if (!converting_ || (now_us < conversion_end_us_)) {
+    return;
+  }
+  converting_ = false;
+  uint8_t resolution = 9 + ((scratchpad_[4] >> 5) & 0x03);
+  int16_t raw = (int16_t)lround((host_environment.water_temperature + offset) * 16);
+  raw &= ~((1 << (12 - resolution)) - 1);
+  scratchpad_[0] = raw & 0xFF;
+  scratchpad_[1] = (uint16_t)raw >> 8;
+  scratchpad_[8] = oneWireCrc8(scratchpad_, 8);
+}
+
+//---------------------------------------------1-WIRE BUS--------------------------------------------//
+void HostOneWireBus::attach(HostDs18b20 *device) {
+  devices_.push_back(device);
+}
+
+void HostOneWireBus::onBoardDrive(uint8_t pin, bool low, uint64_t now_us) {
+  for (size_t i = 0; i < devices_.size(); i++) {
+    devices_[i]->onBoardDrive(low, now_us);
+  }
+}
+
+bool HostOneWireBus::pullsLow(uint8_t pin, uint64_t now_us) {
+  for (size_t i = 0; i < devices_.size(); i++) {
+    if (devices_[i]->pullsLow(now_us)) {
+      return true;
+    }
+  }
+  return false;
+}
@@ -0,0 +1,109 @@
+/**
+ *  \file host_devices.h
+ *  \brief Simulated devices attached to pins in the host build.
+ *  \details Bus devices (TSL2561, COZIR) live with their bus stand-ins in host_twi.cpp
+ *  and host_software_serial.cpp. The devices here sit directly on a pin and are
+ *  attached with hostAttachPinDevice().
+ *  \author Jake Rye
+ */
+#ifndef HOST_DEVICES_H
+#define HOST_DEVICES_H
+
+#include <vector>
+
+#include "Arduino.h"
+
+/**
+ * \brief Simulated DHT22 (AM2302) single-wire temperature & humidity sensor.
+ * \details After the board holds the line low for at least 1 ms and releases it, the
+ * sensor answers with an 80 us low / 80 us high preamble followed by 40 bits, each
+ * a 50 us low followed by a 26 us (0) or 70 us (1) high. Readings come from
+ * host_environment at the moment the transfer starts, plus the offsets. timing_percent
+ * stretches or shrinks the preamble and bits, like a sensor with a slow or fast clock.
+ */
+class HostDht22 : public HostPinDevice {
+  public:
+    HostDht22(float temperature_offset = 0, float humidity_offset = 0);
+    void onBoardDrive(uint8_t pin, bool low, uint64_t now_us);
+    bool pullsLow(uint8_t pin, uint64_t now_us);
+    uint64_t nextChange(uint8_t pin, uint64_t now_us);
+
+    // Public Variables
+    int timing_percent; // of the nominal preamble & bit lengths
+    float temperature_offset; // degrees C added to the air temperature
+    float humidity_offset; // percent added to the air humidity
+    uint32_t transfers; // responses started
+
+  private:
+    uint64_t scaled(uint64_t us);
+    void loadData(void);
+
+    uint64_t low_since_us_;
+    uint64_t transfer_start_us_;
+    bool transferring_;
+    uint8_t data_[5];
+};
+
+/**
+ * \brief Simulated DS18B20 1-wire digital thermometer, attached to a HostOneWireBus.
+ * \details Decodes the time slots of the board by how long it holds the line low: 480 us
+ * or more is a reset, answered with a presence pulse, less than 30 us writes a 1 and
+ * longer writes a 0. When the sensor has bits to send, each slot reads one, a 0 holding
+ * the line low for 40 us. Answers Read ROM, Match ROM, Skip ROM and Search ROM, then
+ * Convert T, Read Scratchpad and Write Scratchpad. A conversion takes 94 to 750 ms at 9 to
+ * 12 bits of resolution, slots read during it return 0, and when it completes the
+ * scratchpad holds the water temperature of host_environment plus offset. With
+ * error_interval set, every nth scratchpad read has a bit flipped to test CRC checks.
+ */
+class HostDs18b20 {
+  public:
+    HostDs18b20(uint64_t serial, float temperature_offset = 0);
+    void onBoardDrive(bool low, uint64_t now_us);
+    bool pullsLow(uint64_t now_us);
+
+    // Public Variables
+    uint8_t rom[8]; // family code, serial & crc
+    float offset; // degrees C added to the water temperature
+    uint32_t error_interval; // every nth scratchpad read is corrupted, 0 for none
+    uint32_t searches; // Search ROM commands
+    uint32_t reads; // Read Scratchpad commands
+    uint32_t conversions; // Convert T commands
+
+  private:
+    enum State {kIdle, kRomCommand, kMatchRom, kSearchRom, kFunctionCommand, kReceive, kSend, kConvert};
+    void receiveBit(bool bit, uint64_t now_us);
+    void receiveByte(uint8_t byte, uint64_t now_us);
+    void send(const uint8_t *data, uint8_t length);
+    void finishConversion(uint64_t now_us);
+
+    State state_;
+    uint64_t fall_us_; // when the board last pulled the line low
+    uint64_t low_until_us_; // the sensor holds the line low until then
+    bool sending_; // the slot in progress reads a bit of the sensor
+    uint64_t conversion_end_us_;
+    bool converting_;
+    uint8_t byte_; // bits received so far, least significant first
+    uint8_t bit_count_;
+    uint8_t search_bit_; // rom bit of Search ROM
+    uint8_t search_step_; // 0 send bit, 1 send complement, 2 receive direction
+    uint8_t buffer_[9]; // bytes to send or received
+    uint8_t length_;
+    uint8_t position_; // bit of buffer_
+    uint8_t scratchpad_[9];
+};
+
+/**
+ * \brief A 1-wire bus with a pull-up resistor: a pin with any number of HostDs18b20s.
+ * The line is low while any of them pulls it low.
+ */
+class HostOneWireBus : public HostPinDevice {
+  public:
+    void attach(HostDs18b20 *device);
+    void onBoardDrive(uint8_t pin, bool low, uint64_t now_us);
+    bool pullsLow(uint8_t pin, uint64_t now_us);
+
+  private:
+    std::vector<HostDs18b20 *> devices_;
+};
+
+#endif // HOST_DEVICES_H
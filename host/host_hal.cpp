@@ -0,0 +1,226 @@
+/**
+ *  \file host_hal.cpp
+ *  \brief Host implementation of the Arduino core functions and simulation controls.
+ *  \details See Arduino.h and host_hal.h for details.
+ *  \author Jake Rye
+ */
+#include "Arduino.h"
+
+#define HOST_PORT_COUNT ((NUM_DIGITAL_PINS + 7) / 8)
+
+volatile uint8_t host_port_registers[HOST_PORT_COUNT * 3]; // PINx, DDRx, PORTx per port
+volatile uint8_t TWBR;
+
+HostEnvironment host_environment = {
+  22.5, // air_temperature
+  45.0, // air_humidity
+  450, // air_co2
+  1200, // light_broadband
+  300, // light_infrared
+  20.0, // water_temperature
+};
+
+enum ExternalDrive {kFloating, kDrivenLow, kDrivenHigh};
+
+static uint8_t external_drive_[NUM_DIGITAL_PINS]; // how each pin is driven from outside the board
+static int analog_value_[NUM_DIGITAL_PINS];
+static HostHeapStats heap_stats_;
+static HostPinDevice *pin_device_[NUM_DIGITAL_PINS];
+
+//-------------------------------------------------PRIVATE-------------------------------------------//
+static volatile uint8_t *modeRegister(volatile uint8_t *base) {
+  return base + 1;
+}
+
+static volatile uint8_t *outputRegister(volatile uint8_t *base) {
+  return base + 2;
+}
+
+static uint8_t portIndex(volatile uint8_t *base) {
+  return (base - host_port_registers) / 3;
+}
+
+static uint8_t boardDrivesLow(volatile uint8_t *base) {
+  return *modeRegister(base) & ~*outputRegister(base);
+}
+
+static void notifyPinDevices(volatile uint8_t *base, uint8_t previous_low) {
+  uint8_t low = boardDrivesLow(base);
+  uint8_t changed = low ^ previous_low;
+  uint8_t port = portIndex(base);
+  for (uint8_t bit = 0; changed && bit < 8; bit++) {
+    uint8_t pin = port * 8 + bit;
+    if ((changed & (1 << bit)) && (pin < NUM_DIGITAL_PINS) && pin_device_[pin]) {
+      pin_device_[pin]->onBoardDrive(pin, low & (1 << bit), hostNow());
+    }
+  }
+}
+
+//-------------------------------------------------ARDUINO-------------------------------------------//
+void pinMode(uint8_t pin, uint8_t mode) {
+  if (pin >= NUM_DIGITAL_PINS) {
+    return;
+  }
+  volatile uint8_t *base = portInputRegister(digitalPinToPort(pin));
+  uint8_t mask = digitalPinToBitMask(pin);
+  if (mode == OUTPUT) {
+    hostPortModeOutput(base, mask);
+  }
+  else {
+    hostPortModeInput(base, mask);
+    if (mode == INPUT_PULLUP) {
+      hostPortWriteHigh(base, mask);
+    }
+    else {
+      hostPortWriteLow(base, mask);
+    }
+  }
+}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+  hostSpend(__builtin_return_address(0), NULL, kHostTimeIo, HOST_COST_DIGITAL_IO_US);
+  if (pin >= NUM_DIGITAL_PINS) {
+    return;
+  }
+  volatile uint8_t *base = portInputRegister(digitalPinToPort(pin));
+  uint8_t mask = digitalPinToBitMask(pin);
+  if (value == LOW) {
+    hostPortWriteLow(base, mask);
+  }
+  else {
+    hostPortWriteHigh(base, mask);
+  }
+}
+
+int digitalRead(uint8_t pin) {
+  hostSpend(__builtin_return_address(0), NULL, kHostTimeIo, HOST_COST_DIGITAL_IO_US);
+  if (pin >= NUM_DIGITAL_PINS) {
+    return LOW;
+  }
+  volatile uint8_t *base = portInputRegister(digitalPinToPort(pin));
+  return (hostPortRead(base) & digitalPinToBitMask(pin)) ? HIGH : LOW;
+}
+
+int analogRead(uint8_t pin) {
+  hostSpend(__builtin_return_address(0), NULL, kHostTimeIo, HOST_COST_ANALOG_READ_US);
+  if (pin < NUM_ANALOG_INPUTS) {
+    pin += A0; // analogRead(0) is the same as analogRead(A0)
+  }
+  if (pin >= NUM_DIGITAL_PINS) {
+    return 0;
+  }
+  return analog_value_[pin];
+}
+
+//-------------------------------------------------HOST----------------------------------------------//
+void *hostHeapRealloc(void *buffer, size_t old_size, size_t new_size) {
+  void *new_buffer = realloc(buffer, new_size);
+  if (new_buffer == NULL) {
+    return NULL;
+  }
+  heap_stats_.allocations++;
+  heap_stats_.allocated_bytes += new_size;
+  heap_stats_.live_bytes += new_size - old_size;
+  if (heap_stats_.live_bytes > heap_stats_.peak_live_bytes) {
+    heap_stats_.peak_live_bytes = heap_stats_.live_bytes;
+  }
+  return new_buffer;
+}
+
+void hostHeapFree(void *buffer, size_t size) {
+  if (buffer == NULL) {
+    return;
+  }
+  free(buffer);
+  heap_stats_.frees++;
+  heap_stats_.live_bytes -= size;
+}
+
+HostHeapStats hostHeapStats(void) {
+  return heap_stats_;
+}
+
+void hostSetDigitalInput(uint8_t pin, uint8_t level) {
+  if (pin < NUM_DIGITAL_PINS) {
+    external_drive_[pin] = (level == LOW) ? kDrivenLow : kDrivenHigh;
+  }
+}
+
+void hostSetAnalogInput(uint8_t pin, int value) {
+  if (pin < NUM_DIGITAL_PINS) {
+    analog_value_[pin] = value;
+  }
+}
+
+uint8_t hostGetDigitalOutput(uint8_t pin) {
+  volatile uint8_t *base = portInputRegister(digitalPinToPort(pin));
+  return (*outputRegister(base) & digitalPinToBitMask(pin)) ? HIGH : LOW;
+}
+
+void hostAttachPinDevice(uint8_t pin, HostPinDevice *device) {
+  if (pin < NUM_DIGITAL_PINS) {
+    pin_device_[pin] = device;
+  }
+}
+
+uint64_t hostNextPinChange(uint8_t pin, uint64_t now_us) {
+  // Only Devices Change A Pin The Board Does Not Drive
+  volatile uint8_t *base = portInputRegister(digitalPinToPort(pin));
+  if ((pin >= NUM_DIGITAL_PINS) || !pin_device_[pin] || (*modeRegister(base) & digitalPinToBitMask(pin))) {
+    return UINT64_MAX;
+  }
+  return pin_device_[pin]->nextChange(pin, now_us);
+}
+
+uint8_t hostPortRead(volatile uint8_t *base) {
+  uint8_t port = portIndex(base);
+  uint8_t mode = *modeRegister(base);
+  uint8_t output = *outputRegister(base);
+  uint8_t value = 0;
+  for (uint8_t bit = 0; bit < 8; bit++) {
+    uint8_t pin = port * 8 + bit;
+    uint8_t mask = 1 << bit;
+    bool level;
+    if (mode & mask) { // driven by the board
+      level = output & mask;
+    }
+    else if ((pin < NUM_DIGITAL_PINS) && pin_device_[pin]) { // bus with pull-up resistor
+      level = !pin_device_[pin]->pullsLow(pin, hostNow());
+    }
+    else if ((pin < NUM_DIGITAL_PINS) && (external_drive_[pin] != kFloating)) { // driven from outside
+      level = (external_drive_[pin] == kDrivenHigh);
+    }
+    else { // only the pull-up, if enabled
+      level = output & mask;
+    }
+    if (level) {
+      value |= mask;
+    }
+  }
+  *base = value;
+  return value;
+}
+
+void hostPortModeInput(volatile uint8_t *base, uint8_t mask) {
+  uint8_t previous_low = boardDrivesLow(base);
+  *modeRegister(base) &= ~mask;
+  notifyPinDevices(base, previous_low);
+}
+
+void hostPortModeOutput(volatile uint8_t *base, uint8_t mask) {
+  uint8_t previous_low = boardDrivesLow(base);
+  *modeRegister(base) |= mask;
+  notifyPinDevices(base, previous_low);
+}
+
+void hostPortWriteLow(volatile uint8_t *base, uint8_t mask) {
+  uint8_t previous_low = boardDrivesLow(base);
+  *outputRegister(base) &= ~mask;
+  notifyPinDevices(base, previous_low);
+}
+
+void hostPortWriteHigh(volatile uint8_t *base, uint8_t mask) {
+  uint8_t previous_low = boardDrivesLow(base);
+  *outputRegister(base) |= mask;
+  notifyPinDevices(base, previous_low);
+}
@@ -0,0 +1,173 @@
+/**
+ *  \file host_hal.h
+ *  \brief Simulation controls for the host build.
+ *  \details The firmware only sees the Arduino API declared in Arduino.h. This header
+ *  is for the harness and the simulated devices: it sets the environment the sensors
+ *  observe, connects a controller to the serial port, and exposes the counters used
+ *  to measure per-cycle cost, heap churn, and message sizes.
+ *  \author Jake Rye
+ */
+#ifndef HOST_HAL_H
+#define HOST_HAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+// Board time charged for calls into the core, estimated for a 16 MHz ATmega2560
+#define HOST_COST_TIMER_US 2 // millis() & micros()
+#define HOST_COST_DIGITAL_IO_US 4 // digitalRead() & digitalWrite()
+#define HOST_COST_ANALOG_READ_US 112 // 13 ADC clocks at 125 kHz plus overhead
+#define HOST_COST_TWI_BYTE_US 90 // 9 bits at 100 kHz
+#define HOST_COST_TWI_FRAME_US 20 // start & stop conditions
+#define HOST_COST_SOFTWARE_SERIAL_BYTE_US 1042 // 10 bits at 9600 baud
+#define HOST_COST_INTERRUPT_US 4 // entering & leaving a timer interrupt
+
+/**
+ * \brief Physical quantities observed by the simulated devices.
+ */
+struct HostEnvironment {
+  float air_temperature; // degrees C
+  float air_humidity; // percent
+  float air_co2; // ppm
+  float light_broadband; // tsl2561 channel 0 counts
+  float light_infrared; // tsl2561 channel 1 counts
+  float water_temperature; // degrees C
+};
+
+/**
+ * \brief Heap counters, updated by every String (re)allocation.
+ */
+struct HostHeapStats {
+  uint32_t allocations; // malloc & realloc calls
+  uint32_t frees;
+  uint32_t allocated_bytes; // total bytes requested
+  uint32_t live_bytes;
+  uint32_t peak_live_bytes;
+};
+
+/**
+ * \brief Serial counters, seen from the board.
+ */
+struct HostSerialStats {
+  uint32_t tx_bytes;
+  uint32_t rx_bytes;
+  uint32_t rx_overflows; // bytes dropped because the rx buffer was full
+};
+
+/**
+ * \brief Interrupt counters.
+ */
+struct HostInterruptStats {
+  uint32_t timer_interrupts;
+  uint32_t pin_interrupts; // external interrupts
+  uint64_t interrupt_us; // board time spent in interrupts
+  uint64_t max_latency_us; // longest a due interrupt waited, e.g. for interrupts() to be called
+};
+
+/**
+ * \brief Kinds of board time recorded by the virtual clock.
+ */
+enum HostTimeKind {
+  kHostTimeWait, // delay() & delayMicroseconds()
+  kHostTimePoll, // millis() & micros(), i.e. spinning on the clock
+  kHostTimeIo // peripheral transfers & conversions
+};
+
+/**
+ * \brief Board time spent by one function (or labelled peripheral), per kind.
+ */
+struct HostTimeRecord {
+  std::string name;
+  const char *kind;
+  uint32_t calls;
+  uint64_t total_us;
+  uint64_t max_us;
+  HostTimeRecord() : kind(""), calls(0), total_us(0), max_us(0) {}
+};
+
+/**
+ * \brief A device wired to a pin with a pull-up resistor (e.g. a DHT22 or 1-wire bus).
+ */
+class HostPinDevice {
+  public:
+    virtual ~HostPinDevice() {}
+
+    /**
+     * \brief Called whenever the board starts (low = true) or stops driving the pin low.
+     */
+    virtual void onBoardDrive(uint8_t pin, bool low, uint64_t now_us) = 0;
+
+    /**
+     * \brief Returns true while the device pulls the pin low.
+     */
+    virtual bool pullsLow(uint8_t pin, uint64_t now_us) = 0;
+
+    /**
+     * \brief Returns the first time after now_us at which the device starts or stops
+     * pulling the pin low, for external interrupts. UINT64_MAX if it is not going to.
+     */
+    virtual uint64_t nextChange(uint8_t pin, uint64_t now_us) { return UINT64_MAX; }
+};
+
+/**
+ * \brief The other end of the serial line (i.e. the controller).
+ */
+class HostSerialPeer {
+  public:
+    virtual ~HostSerialPeer() {}
+
+    /**
+     * \brief Called for every byte the firmware writes to Serial.
+     */
+    virtual void onBoardByte(uint8_t c) = 0;
+
+    /**
+     * \brief Baud rate the peer's uart is set to, 0 if it always matches the board.
+     * Bytes only get through when both ends use the same rate.
+     */
+    virtual unsigned long baud(void) { return 0; }
+};
+
+extern HostEnvironment host_environment;
+
+// Heap
+void *hostHeapRealloc(void *buffer, size_t old_size, size_t new_size);
+void hostHeapFree(void *buffer, size_t size);
+HostHeapStats hostHeapStats(void);
+
+// Pins
+void hostSetDigitalInput(uint8_t pin, uint8_t level);
+void hostSetAnalogInput(uint8_t pin, int value);
+uint8_t hostGetDigitalOutput(uint8_t pin);
+void hostAttachPinDevice(uint8_t pin, HostPinDevice *device);
+
+// Port Registers (used by the DIRECT_* macros in support_one_wire.h)
+uint8_t hostPortRead(volatile uint8_t *base);
+void hostPortModeInput(volatile uint8_t *base, uint8_t mask);
+void hostPortModeOutput(volatile uint8_t *base, uint8_t mask);
+void hostPortWriteLow(volatile uint8_t *base, uint8_t mask);
+void hostPortWriteHigh(volatile uint8_t *base, uint8_t mask);
+
+// Virtual Clock
+uint64_t hostNow(void);
+void hostSpend(const void *site, const char *label, HostTimeKind kind, uint64_t us);
+std::vector<HostTimeRecord> hostTimeRecords(void);
+void hostClearTimeRecords(void);
+void hostSetClockDrift(double ppm); // the board's millis() & micros() run fast by ppm, slow if negative
+
+// Interrupts (run while the clock advances, see host_clock.cpp)
+void hostSetTimer(uint32_t us, void (*handler)(void)); // calls handler once, us from now, stands in for a compare match
+void hostCancelTimer(void);
+uint64_t hostNextPinChange(uint8_t pin, uint64_t now_us); // when a device next changes the level, UINT64_MAX if never
+HostInterruptStats hostInterruptStats(void);
+
+// Serial
+void hostSerialAttachPeer(HostSerialPeer *peer);
+void hostSerialInject(const uint8_t *buffer, size_t size);
+void hostSerialSetLinkLimit(unsigned long baud); // bytes are garbled above this rate, 0 for no limit
+HostSerialStats hostSerialStats(void);
+
+#endif // HOST_HAL_H
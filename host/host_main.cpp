@@ -0,0 +1,316 @@
+/**
+ *  \file host_main.cpp
+ *  \brief Runs the firmware as a Linux binary.
+ *  \details Calls setup() once and loop() for the requested number of cycles, or until
+ *  the requested amount of simulated time has passed, with a simulated controller on
+ *  Serial and simulated devices on the module pins. A cycle ends when the board sends a
+ *  stream message. Time is virtual (see host_clock.cpp) so a simulated day runs in seconds.
+ *  A pass of loop() that takes less than a millisecond is padded to one, the resolution of
+ *  the board's millis() tick, and the padding is reported as idle time. Instructions given
+ *  with --send are sent one second into the first cycle and the time until the board
+ *  has handled them (and until each response, if any) is reported. After every cycle a line is printed with the board time (total
+ *  and busy) and host cost of the cycle, heap churn, and bytes sent to the controller. At
+ *  the end, the board time spent in every blocking call is listed per calling function.
+ *  --max-baud sets the highest rate the controller accepts when the board negotiates the
+ *  baud rate (0 for a controller that does not negotiate), --link-baud the highest rate
+ *  the wire carries. The rate the board settles on is printed after setup. --sync has the
+ *  controller send its time to the board every <s> seconds, starting with the instructions,
+ *  and --clock-drift makes the board's clock run fast (or slow, if negative) by <ppm>.
+ *  The offset of the board clock at the syncs and the drift it learned are then reported.
+ *  --send-at sends an instruction <s> seconds after setup() instead, e.g. a GHST history
+ *  download once the ring has filled, and the history and rollup frames received are reported.
+ *  The water temperature probe is a DS18B20 on the 1-wire bus of pin 5. --ds18b20-errors
+ *  corrupts every <n>th scratchpad read of it, --ds18b20-probes 0 leaves it off the bus
+ *  and --ds18b20-swap-at replaces it with one of another ROM code, 10 C warmer, <s>
+ *  seconds after setup(). The probes found and the CRC errors of the reads of the board
+ *  are reported with it.
+ *  The air sensor is a DHT22 on pin A0. --dht22-sensors 0 leaves it unwired and
+ *  --dht22-timing stretches its pulses to <percent> of the nominal length. The bit
+ *  timings the board measured are reported with it.
+ *
+ *  Usage: gro_host [--cycles <n> | --hours <h>] [--send "<instruction>"]... [--send-at <s> "<instruction>"]... [--disconnected] [--max-baud <rate>] [--link-baud <rate>] [--sync <s>] [--clock-drift <ppm>] [--ds18b20-errors <n>] [--ds18b20-probes <n>] [--ds18b20-swap-at <s>] [--dht22-sensors <n>] [--dht22-timing <percent>] [--echo] [--summary]
+ *  \author Jake Rye
+ */
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "Arduino.h"
+#include "host_controller.h"
+#include "host_devices.h"
+#include "sensor_dht22.h"
+#include "sensor_ds18b20.h"
+
+#define SECONDS_PER_DAY 86400.0
+#define PASS_US 1000 // millis() tick, shortest simulated pass of loop()
+#define SEND_DELAY_US 1000000 // instructions are sent this long after setup()
+#define CYCLE_TIMEOUT_US 10000000 // cycle ends without a stream message after this long
+
+extern SensorDht22 sensor_dht22_air_temperature_humidity_default; // module_handler.cpp
+extern SensorDs18b20 sensor_ds18b20_water_temperature;
+
+static HostController controller;
+static HostDht22 air_sensor;
+static const uint8_t kAirSensorPin = A0;
+static HostOneWireBus water_bus;
+static const uint8_t kWaterBusPin = 5;
+static HostDs18b20 water_probe(0x0000A1B2C3D4ULL);
+static const HostDs18b20 kSwappedWaterProbe(0x00005A5A0B0EULL, 10); // replaces the water probe
+static int water_probe_count = 1;
+static int air_sensor_count = 1;
+
+//-------------------------------------------------PRIVATE-------------------------------------------//
+static void attachDevices(void) {
+  // Wiring Matches module_handler.cpp
+  if (air_sensor_count > 0) {
+    hostAttachPinDevice(kAirSensorPin, &air_sensor);
+  }
+  if (water_probe_count > 0) {
+    water_bus.attach(&water_probe);
+  }
+  hostAttachPinDevice(kWaterBusPin, &water_bus);
+  hostSetAnalogInput(A1, 411); // vernier ph ~6.0
+  hostSetAnalogInput(A2, 34); // vernier ec ~1.5 mS/cm
+}
+
+static void updateEnvironment(void) {
+  // Greenhouse Day: Lights On From 06:00 To 22:00, Warmest & Driest Mid Afternoon
+  double seconds = fmod(hostNow() / 1000000.0, SECONDS_PER_DAY);
+  double hours = seconds / 3600;
+  double phase = cos(2 * M_PI * (hours - 15) / 24);
+  bool lights_on = (hours >= 6) && (hours < 22);
+  host_environment.air_temperature = 22 + 4 * phase;
+  host_environment.air_humidity = 50 - 10 * phase;
+  host_environment.air_co2 = lights_on ? 420 : 600;
+  host_environment.light_broadband = lights_on ? 1200 : 4;
+  host_environment.light_infrared = lights_on ? 300 : 1;
+  host_environment.water_temperature = 20 + phase;
+}
+
+static double cpuMicroseconds(void) {
+  return (double)clock() * 1000000 / CLOCKS_PER_SEC;
+}
+
+static bool compareTotal(const HostTimeRecord &a, const HostTimeRecord &b) {
+  return a.total_us > b.total_us;
+}
+
+static void printTimeRecords(double cycles) {
+  std::vector<HostTimeRecord> records = hostTimeRecords();
+  std::sort(records.begin(), records.end(), compareTotal);
+  printf("%-48s %-4s %12s %14s %12s %12s\n", "board time by caller", "kind", "calls", "total_us", "us/cycle", "max_us");
+  for (size_t i = 0; i < records.size(); i++) {
+    printf("%-48s %-4s %12u %14llu %12.0f %12llu\n", records[i].name.c_str(), records[i].kind, records[i].calls,
+           (unsigned long long)records[i].total_us, records[i].total_us / cycles,
+           (unsigned long long)records[i].max_us);
+  }
+}
+
+static void printUsage(const char *name) {
+  fprintf(stderr, "Usage: %s [--cycles <n> | --hours <h>] [--send \"<instruction>\"]... [--send-at <s> \"<instruction>\"]... [--disconnected] [--max-baud <rate>] [--link-baud <rate>] [--sync <s>] [--clock-drift <ppm>] [--ds18b20-errors <n>] [--ds18b20-probes <n>] [--ds18b20-swap-at <s>] [--dht22-sensors <n>] [--dht22-timing <percent>] [--echo] [--summary]\n", name);
+}
+
+//--------------------------------------------------MAIN---------------------------------------------//
+int main(int argc, char **argv) {
+  // Parse Arguments
+  int cycles = 3;
+  double hours = 0;
+  bool summary = false;
+  uint64_t sync_us = 0;
+  double swap_seconds = -1;
+  std::vector<std::string> instructions;
+  std::vector<std::pair<double, std::string> > timed_instructions;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--cycles") && i + 1 < argc) {
+      cycles = atoi(argv[++i]);
+    }
+    else if (!strcmp(argv[i], "--hours") && i + 1 < argc) {
+      hours = atof(argv[++i]);
+    }
+    else if (!strcmp(argv[i], "--send") && i + 1 < argc) {
+      instructions.push_back(argv[++i]);
+    }
+    else if (!strcmp(argv[i], "--send-at") && i + 2 < argc) {
+      double seconds = atof(argv[++i]);
+      timed_instructions.push_back(std::make_pair(seconds, std::string(argv[++i])));
+    }
+    else if (!strcmp(argv[i], "--max-baud") && i + 1 < argc) {
+      controller.max_baud = strtoul(argv[++i], NULL, 10);
+    }
+    else if (!strcmp(argv[i], "--link-baud") && i + 1 < argc) {
+      hostSerialSetLinkLimit(strtoul(argv[++i], NULL, 10));
+    }
+    else if (!strcmp(argv[i], "--sync") && i + 1 < argc) {
+      sync_us = (uint64_t)(atof(argv[++i]) * 1000000);
+    }
+    else if (!strcmp(argv[i], "--clock-drift") && i + 1 < argc) {
+      hostSetClockDrift(atof(argv[++i]));
+    }
+    else if (!strcmp(argv[i], "--ds18b20-errors") && i + 1 < argc) {
+      water_probe.error_interval = strtoul(argv[++i], NULL, 10);
+    }
+    else if (!strcmp(argv[i], "--ds18b20-probes") && i + 1 < argc) {
+      water_probe_count = std::min(std::max(atoi(argv[++i]), 0), 1);
+    }
+    else if (!strcmp(argv[i], "--ds18b20-swap-at") && i + 1 < argc) {
+      swap_seconds = atof(argv[++i]);
+    }
+    else if (!strcmp(argv[i], "--dht22-sensors") && i + 1 < argc) {
+      air_sensor_count = std::min(std::max(atoi(argv[++i]), 0), 1);
+    }
+    else if (!strcmp(argv[i], "--dht22-timing") && i + 1 < argc) {
+      air_sensor.timing_percent = std::max(atoi(argv[++i]), 1);
+    }
+    else if (!strcmp(argv[i], "--disconnected")) {
+      controller.acknowledge_enquiry = false;
+    }
+    else if (!strcmp(argv[i], "--echo")) {
+      controller.echo = true;
+    }
+    else if (!strcmp(argv[i], "--summary")) {
+      summary = true;
+    }
+    else {
+      printUsage(argv[0]);
+      return 1;
+    }
+  }
+
+  // Setup
+  hostSerialAttachPeer(&controller);
+  attachDevices();
+  updateEnvironment();
+  setup();
+  printf("setup: board_us=%llu baud=%lu\n", (unsigned long long)hostNow(), Serial.baud());
+  hostClearTimeRecords();
+  uint64_t setup_us = hostNow();
+  uint64_t send_us = setup_us + SEND_DELAY_US;
+  uint64_t next_sync_us = send_us;
+
+  // Loop
+  uint64_t end_us = hostNow() + (uint64_t)(hours * 3600 * 1000000);
+  HostHeapStats heap_total = hostHeapStats();
+  uint32_t tx_total = hostSerialStats().tx_bytes;
+  uint64_t board_total = hostNow();
+  uint64_t idle_total = 0;
+  uint64_t pending_since_us = 0;
+  double cpu_total = cpuMicroseconds();
+  int cycle = 0;
+  while ((hours > 0) ? (hostNow() < end_us) : (cycle < cycles)) {
+    cycle++;
+    updateEnvironment();
+    HostHeapStats heap_before = hostHeapStats();
+    HostSerialStats serial_before = hostSerialStats();
+    uint64_t board_before = hostNow();
+    uint64_t idle_before = idle_total;
+    double cpu_before = cpuMicroseconds();
+
+    // Run Passes Of loop() Until The Board Streams
+    uint32_t streams = controller.streams;
+    uint32_t passes = 0;
+    while (controller.streams == streams && hostNow() - board_before < CYCLE_TIMEOUT_US) {
+      if (!instructions.empty() && hostNow() >= send_us) {
+        for (size_t i = 0; i < instructions.size(); i++) {
+          controller.sendInstruction(instructions[i]);
+        }
+        instructions.clear();
+        pending_since_us = hostNow();
+      }
+      for (size_t i = 0; i < timed_instructions.size(); i++) {
+        if (hostNow() >= setup_us + (uint64_t)(timed_instructions[i].first * 1000000)) {
+          controller.sendInstruction(timed_instructions[i].second);
+          timed_instructions.erase(timed_instructions.begin() + i--);
+          pending_since_us = hostNow();
+        }
+      }
+      if ((swap_seconds >= 0) && (hostNow() >= setup_us + (uint64_t)(swap_seconds * 1000000))) {
+        uint32_t error_interval = water_probe.error_interval;
+        water_probe = kSwappedWaterProbe; // same place on the bus
+        water_probe.error_interval = error_interval;
+        swap_seconds = -1;
+      }
+      if (sync_us && hostNow() >= next_sync_us) {
+        controller.syncTime();
+        next_sync_us += sync_us;
+      }
+      uint64_t pass_before = hostNow();
+      loop();
+      passes++;
+      if (pending_since_us && !Serial.receiving() && !Serial.available()) { // board has read the instructions
+        printf("instructions handled: latency_us=%llu\n", (unsigned long long)(hostNow() - pending_since_us));
+        pending_since_us = 0;
+      }
+      uint64_t pass_us = hostNow() - pass_before;
+      if (pass_us < PASS_US) {
+        hostSpend(NULL, "idle", kHostTimeWait, PASS_US - pass_us);
+        idle_total += PASS_US - pass_us;
+      }
+    }
+
+    double cpu_us = cpuMicroseconds() - cpu_before;
+    HostHeapStats heap_after = hostHeapStats();
+    HostSerialStats serial_after = hostSerialStats();
+    size_t messages = controller.takeMessages().size();
+    if (!summary) {
+      printf("cycle %d: board_us=%llu busy_us=%llu passes=%u host_cpu_us=%.0f allocations=%u allocated_bytes=%u peak_heap_bytes=%u messages=%u tx_bytes=%u\n",
+             cycle, (unsigned long long)(hostNow() - board_before),
+             (unsigned long long)(hostNow() - board_before - (idle_total - idle_before)), passes, cpu_us,
+             heap_after.allocations - heap_before.allocations,
+             heap_after.allocated_bytes - heap_before.allocated_bytes,
+             heap_after.peak_live_bytes,
+             (unsigned)messages,
+             serial_after.tx_bytes - serial_before.tx_bytes);
+    }
+  }
+
+  // Summary
+  HostHeapStats heap = hostHeapStats();
+  printf("total: cycles=%d board_s=%.1f busy_s=%.1f host_cpu_s=%.2f allocations=%u frees=%u peak_heap_bytes=%u tx_bytes=%u bad_frames=%u dht22_transfers=%u\n",
+         cycle, (hostNow() - board_total) / 1e6, (hostNow() - board_total - idle_total) / 1e6,
+         (cpuMicroseconds() - cpu_total) / 1e6,
+         heap.allocations - heap_total.allocations, heap.frees - heap_total.frees,
+         heap.peak_live_bytes, hostSerialStats().tx_bytes - tx_total, controller.bad_frames,
+         air_sensor.transfers);
+  for (size_t i = 0; i < controller.response_latencies_us.size(); i++) {
+    printf("response %u: latency_us=%llu\n", (unsigned)i + 1, (unsigned long long)controller.response_latencies_us[i]);
+  }
+  if (controller.history_frames) {
+    printf("history: frames=%u records=%u bytes=%u duration_us=%llu\n", controller.history_frames,
+           controller.history_records, controller.history_bytes,
+           (unsigned long long)(controller.history_last_us - controller.history_first_us));
+  }
+  if (water_probe_count > 0) {
+    printf("ds18b20 1: searches=%u reads=%u conversions=%u\n", water_probe.searches, water_probe.reads,
+           water_probe.conversions);
+  }
+  SensorDs18b20 &water = sensor_ds18b20_water_temperature;
+  printf("ds18b20: probes_found=%u searches=%u crc_errors=%u retries=%u\n", water.probes_found, water.searches,
+         water.crc_errors, water.retries);
+  SensorDht22 &air = sensor_dht22_air_temperature_humidity_default;
+  printf("dht22: checksum_errors=%u timeouts=%u retries=%u\n", air.checksum_errors, air.timeouts, air.retries);
+  if (air_sensor_count > 0) {
+    SensorDht22::Timing &timing = air.timings[0];
+    printf("dht22 1: transfers=%u preamble=%u/%u bit_low=%u zero_high=%u one_high=%u\n", air_sensor.transfers,
+           timing.preamble_low, timing.preamble_high, timing.bit_low, timing.zero_high, timing.one_high);
+  }
+  HostInterruptStats interrupt = hostInterruptStats();
+  if (interrupt.timer_interrupts || interrupt.pin_interrupts) {
+    printf("interrupts: timer=%u pin=%u interrupt_us=%llu max_latency_us=%llu\n", interrupt.timer_interrupts,
+           interrupt.pin_interrupts, (unsigned long long)interrupt.interrupt_us,
+           (unsigned long long)interrupt.max_latency_us);
+  }
+  if (controller.rollup_frames) {
+    printf("rollup: frames=%u summaries=%u bytes=%u\n", controller.rollup_frames, controller.rollup_summaries,
+           controller.rollup_bytes);
+  }
+  if (controller.time_syncs) {
+    printf("time: syncs=%u offset_ms=%ld max_offset_ms=%ld drift_ppm=%.1f\n", controller.time_syncs,
+           controller.time_offset_ms, controller.max_time_offset_ms, controller.time_drift_ppm);
+  }
+  printTimeRecords(cycle ? cycle : 1);
+  return 0;
+}
@@ -0,0 +1,154 @@
+/**
+ *  \file host_software_serial.cpp
+ *  \brief Host stand-in for support_software_serial.cpp with a simulated GC0011 (COZIR).
+ *  \details Implements the SoftwareSerial class declared in support_software_serial.h.
+ *  Every line written to the port is handled by a COZIR model that answers polling
+ *  mode commands ("K", "A", "Z", "T", "H") using the values in host_environment.
+ *  Transmitting blocks for the bit-banged byte time, with interrupts off for the start
+ *  and data bits as the cli() of the real write() does, so interrupts due meanwhile run
+ *  late. Responses arrive one byte time apart on the virtual clock, as they would at
+ *  9600 baud.
+ *  \author Jake Rye
+ */
+#include "Arduino.h"
+#include "support_software_serial.h"
+
+#include <stdio.h>
+
+SoftwareSerial *SoftwareSerial::active_object = 0;
+
+#define COZIR_RESPONSE_DELAY_US 2000
+
+static char receive_buffer_[_SS_MAX_RX_BUFF];
+static uint64_t receive_time_[_SS_MAX_RX_BUFF]; // when each byte has fully arrived
+static uint8_t receive_buffer_head_ = 0;
+static uint8_t receive_buffer_tail_ = 0;
+static char cozir_command_[16];
+static uint8_t cozir_command_length_ = 0;
+
+//-------------------------------------------------PRIVATE-------------------------------------------//
+static void receiveBytes(const char *buffer) {
+  uint64_t arrival = hostNow() + COZIR_RESPONSE_DELAY_US;
+  while (*buffer) {
+    arrival += HOST_COST_SOFTWARE_SERIAL_BYTE_US;
+    uint8_t next = (receive_buffer_tail_ + 1) % _SS_MAX_RX_BUFF;
+    if (next == receive_buffer_head_) {
+      return; // overflow
+    }
+    receive_buffer_[receive_buffer_tail_] = *buffer++;
+    receive_time_[receive_buffer_tail_] = arrival;
+    receive_buffer_tail_ = next;
+  }
+}
+
+static void handleCozirCommand(const char *command) {
+  char response[24];
+  int value;
+  switch (command[0]) {
+    case 'K':
+    case 'A':
+      value = atoi(command + 1);
+      break;
+    case 'Z':
+      value = (int)host_environment.air_co2;
+      break;
+    case 'T':
+      value = (int)lround(host_environment.air_temperature * 10) + 1000;
+      break;
+    case 'H':
+      value = (int)lround(host_environment.air_humidity * 10);
+      break;
+    default:
+      return; // unsupported commands are ignored by the model
+  }
+  snprintf(response, sizeof(response), " %c %05d\r\n", command[0], value);
+  receiveBytes(response);
+}
+
+//--------------------------------------------------PUBLIC-------------------------------------------//
+SoftwareSerial::SoftwareSerial(uint8_t receivePin, uint8_t transmitPin, bool inverse_logic) {
+  _receivePin = receivePin;
+  _inverse_logic = inverse_logic;
+  _buffer_overflow = false;
+}
+
+SoftwareSerial::~SoftwareSerial() {
+  end();
+}
+
+void SoftwareSerial::begin(long speed) {
+  listen();
+}
+
+bool SoftwareSerial::listen() {
+  if (active_object == this) {
+    return false;
+  }
+  active_object = this;
+  receive_buffer_head_ = receive_buffer_tail_ = 0;
+  return true;
+}
+
+void SoftwareSerial::end() {
+  stopListening();
+}
+
+bool SoftwareSerial::stopListening() {
+  if (active_object == this) {
+    active_object = NULL;
+    return true;
+  }
+  return false;
+}
+
+int SoftwareSerial::peek() {
+  if (!available()) {
+    return -1;
+  }
+  return receive_buffer_[receive_buffer_head_];
+}
+
+size_t SoftwareSerial::write(uint8_t byte) {
+  // Interrupts Off For The Start & 8 Data Bits, On For The Stop Bit
+  noInterrupts();
+  hostSpend(NULL, "SoftwareSerial::write", kHostTimeIo, HOST_COST_SOFTWARE_SERIAL_BYTE_US * 9 / 10);
+  interrupts();
+  hostSpend(NULL, "SoftwareSerial::write", kHostTimeIo, HOST_COST_SOFTWARE_SERIAL_BYTE_US / 10);
+  if (byte == '\n') {
+    cozir_command_[cozir_command_length_] = 0;
+    if (isListening()) {
+      handleCozirCommand(cozir_command_);
+    }
+    cozir_command_length_ = 0;
+  }
+  else if (byte != '\r' && cozir_command_length_ < sizeof(cozir_command_) - 1) {
+    cozir_command_[cozir_command_length_++] = byte;
+  }
+  return 1;
+}
+
+int SoftwareSerial::read() {
+  if (!available()) {
+    return -1;
+  }
+  uint8_t d = receive_buffer_[receive_buffer_head_];
+  receive_buffer_head_ = (receive_buffer_head_ + 1) % _SS_MAX_RX_BUFF;
+  return d;
+}
+
+int SoftwareSerial::available() {
+  if (!isListening()) {
+    return 0;
+  }
+  int count = 0;
+  for (uint8_t i = receive_buffer_head_; i != receive_buffer_tail_; i = (i + 1) % _SS_MAX_RX_BUFF) {
+    if (receive_time_[i] > hostNow()) {
+      break;
+    }
+    count++;
+  }
+  return count;
+}
+
+void SoftwareSerial::flush() {
+}
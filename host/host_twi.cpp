@@ -0,0 +1,89 @@
+/**
+ *  \file host_twi.cpp
+ *  \brief Host stand-in for support_twi.c with a simulated TSL2561 on the bus.
+ *  \details support_wire.cpp is compiled unchanged and calls into these functions.
+ *  The TSL2561 model implements the command register protocol used by SensorTsl2561:
+ *  a write of 0x80|register selects a register, a second byte writes it, and a read
+ *  returns the selected register. Channel counts come from host_environment. Every
+ *  transfer is charged to the virtual clock at 100 kHz.
+ *  \author Jake Rye
+ */
+#include "Arduino.h"
+
+extern "C" {
+  #include "support_twi.h"
+}
+
+#define TSL2561_ADDRESS 0x29
+#define TSL2561_COMMAND_BIT 0x80
+#define TSL2561_REGISTER_MASK 0x0F
+#define TSL2561_REGISTER_CONTROL 0x00
+#define TSL2561_POWER_UP 0x03
+
+static uint8_t tsl2561_registers_[16];
+static uint8_t tsl2561_selected_register_;
+
+//-------------------------------------------------PRIVATE-------------------------------------------//
+static uint8_t tsl2561ReadRegister(uint8_t reg) {
+  bool powered = (tsl2561_registers_[TSL2561_REGISTER_CONTROL] & 0x03) == TSL2561_POWER_UP;
+  uint16_t ch0 = powered ? (uint16_t)host_environment.light_broadband : 0;
+  uint16_t ch1 = powered ? (uint16_t)host_environment.light_infrared : 0;
+  switch (reg) {
+    case 0x0C: return ch0 & 0xFF;
+    case 0x0D: return ch0 >> 8;
+    case 0x0E: return ch1 & 0xFF;
+    case 0x0F: return ch1 >> 8;
+    default: return tsl2561_registers_[reg];
+  }
+}
+
+//-------------------------------------------------TWI-----------------------------------------------//
+void twi_init(void) {
+}
+
+void twi_setAddress(uint8_t address) {
+}
+
+uint8_t twi_readFrom(uint8_t address, uint8_t *data, uint8_t length, uint8_t send_stop) {
+  hostSpend(NULL, "twi_readFrom", kHostTimeIo, HOST_COST_TWI_FRAME_US + (1 + length) * HOST_COST_TWI_BYTE_US);
+  if (address != TSL2561_ADDRESS) {
+    return 0; // no device acknowledged
+  }
+  for (uint8_t i = 0; i < length; i++) {
+    data[i] = tsl2561ReadRegister(tsl2561_selected_register_);
+  }
+  return length;
+}
+
+uint8_t twi_writeTo(uint8_t address, uint8_t *data, uint8_t length, uint8_t wait, uint8_t send_stop) {
+  hostSpend(NULL, "twi_writeTo", kHostTimeIo, HOST_COST_TWI_FRAME_US + (1 + length) * HOST_COST_TWI_BYTE_US);
+  if (address != TSL2561_ADDRESS) {
+    return 2; // address send, nack received
+  }
+  if (length >= 1 && (data[0] & TSL2561_COMMAND_BIT)) {
+    tsl2561_selected_register_ = data[0] & TSL2561_REGISTER_MASK;
+  }
+  if (length >= 2) {
+    tsl2561_registers_[tsl2561_selected_register_] = data[1];
+  }
+  return 0;
+}
+
+uint8_t twi_transmit(const uint8_t *data, uint8_t length) {
+  return 1; // slave mode is not simulated
+}
+
+void twi_attachSlaveRxEvent(void (*function)(uint8_t *, int)) {
+}
+
+void twi_attachSlaveTxEvent(void (*function)(void)) {
+}
+
+void twi_reply(uint8_t ack) {
+}
+
+void twi_stop(void) {
+}
+
+void twi_releaseBus(void) {
+}
@@ -0,0 +1,28 @@
+/**
+ *  \file host_test.h
+ *  \brief Checks for the host tests.
+ *  \details A test is a Linux binary built against the host build of the firmware (see
+ *  ../Makefile). CHECK() prints the failed condition with its line and counts it, and
+ *  finishTest() returns the exit status, so "make test" fails if any check does.
+ *  \author Jake Rye
+ */
+#ifndef HOST_TEST_H
+#define HOST_TEST_H
+
+#include <stdio.h>
+
+static int host_test_failures = 0;
+
+#define CHECK(condition) do { \
+    if (!(condition)) { \
+      printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+      host_test_failures++; \
+    } \
+  } while (0)
+
+static int finishTest(const char *name) {
+  printf("%s: %s\n", name, host_test_failures ? "FAILED" : "passed");
+  return host_test_failures ? 1 : 0;
+}
+
+#endif // HOST_TEST_H
@@ -0,0 +1,73 @@
+/**
+ *  \file test_dht22.cpp
+ *  \brief Host test of the DHT22 module with two sensors (see sensor_dht22.h).
+ *  \details The default registry has a single sensor on A0, which has no external
+ *  interrupt and is read polled, so this builds the setup it gives as an example: the
+ *  canopy top & bottom on pins 19 & 18 as SATM/SAHU 1 & 3. Reads them in the background
+ *  as the scheduler does and checks the readings printed for each id and that both
+ *  transfers were captured at once.
+ *  \author Jake Rye
+ */
+#include <string>
+
+#include "Arduino.h"
+#include "host_devices.h"
+#include "host_hal.h"
+#include "sensor_dht22.h"
+#include "support_message.h"
+#include "host_test.h"
+
+/**
+ * \brief Collects what is printed to it.
+ */
+class StringPrint : public Print {
+  public:
+    size_t write(uint8_t c) {
+      text += (char)c;
+      return 1;
+    }
+    std::string text;
+};
+
+//-------------------------------------------------PRIVATE-------------------------------------------//
+static std::string print(SensorDht22 &sensor) {
+  StringPrint json;
+  MessageWriter message(json);
+  sensor.print(message);
+  return json.text;
+}
+
+//--------------------------------------------------MAIN---------------------------------------------//
+int main(void) {
+  host_environment.air_temperature = 20;
+  host_environment.air_humidity = 50;
+
+  // Canopy Top & Bottom On Interrupts 4 & 5, Both On Port D
+  HostDht22 top, bottom(-1.5, 6);
+  hostAttachPinDevice(19, &top);
+  hostAttachPinDevice(18, &bottom);
+  const uint8_t pins[] = {19, 18};
+  const uint8_t ids[] = {1, 3};
+  SensorDht22 sensor(pins, ids, 2, "SATM", "SAHU");
+  sensor.begin();
+
+  // Read In The Background, The Loop Keeps Polling Meanwhile
+  delay(2000);
+  uint64_t start_us = hostNow();
+  sensor.update();
+  uint32_t polls = 1;
+  while (!sensor.finishUpdate()) {
+    delay(1);
+    polls++;
+  }
+  uint64_t read_us = hostNow() - start_us;
+  CHECK(polls > 1);
+  CHECK(hostInterruptStats().pin_interrupts > 0);
+  CHECK(print(sensor) == "\"SATM 1\":20.0,\"SAHU 1\":50.0,\"SATM 3\":18.5,\"SAHU 3\":56.0,");
+  CHECK(sensor.checksum_errors == 0 && sensor.timeouts == 0);
+
+  // Both Transfers At Once, In About The Time Of One
+  CHECK(top.transfers == 1 && bottom.transfers == 1);
+  CHECK(read_us < 10000);
+  return finishTest("test_dht22");
+}
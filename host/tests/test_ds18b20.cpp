@@ -0,0 +1,143 @@
+/**
+ *  \file test_ds18b20.cpp
+ *  \brief Host test of the DS18B20 module with several probes (see sensor_ds18b20.h).
+ *  \details The default registry has a single probe, so this builds the multi-probe setup
+ *  it gives as an example: the water & 2 root zone probes as SWTM 1 to 3. Reads them in
+ *  the background as the scheduler does and checks the readings printed for each id, with
+ *  every probe on the bus at begin() and with one plugged in later. The probes are also
+ *  spread over two buses on pins of one port, which are read in lockstep.
+ *  \author Jake Rye
+ */
+#include <string>
+
+#include "Arduino.h"
+#include "host_devices.h"
+#include "host_hal.h"
+#include "sensor_ds18b20.h"
+#include "support_message.h"
+#include "host_test.h"
+
+/**
+ * \brief Collects what is printed to it.
+ */
+class StringPrint : public Print {
+  public:
+    size_t write(uint8_t c) {
+      text += (char)c;
+      return 1;
+    }
+    std::string text;
+};
+
+//-------------------------------------------------PRIVATE-------------------------------------------//
+static uint64_t sample(SensorDs18b20 &sensor) {
+  // Sample & Wait For The Background Reads, As updateModules() Does
+  delay(sensor.getMinimumPeriod());
+  uint64_t start_us = hostNow();
+  sensor.update();
+  while (!sensor.finishUpdate()) {
+    delay(1);
+  }
+  return hostNow() - start_us;
+}
+
+static std::string read(SensorDs18b20 &sensor) {
+  sample(sensor);
+  StringPrint json;
+  MessageWriter message(json);
+  sensor.print(message);
+  return json.text;
+}
+
+static void checkOneBus(void) {
+  // Three Probes On Pin 5, Numbered In The Order The Search Finds Their ROM Codes
+  HostOneWireBus bus;
+  HostDs18b20 water(0x0000A1B2C3D4ULL), root_zone(0x000051F00D01ULL, 1.5), drain(0x0000E7C0FFEEULL, 2);
+  bus.attach(&water);
+  bus.attach(&root_zone);
+  bus.attach(&drain);
+  hostAttachPinDevice(5, &bus);
+  SensorDs18b20 sensor(5, "SWTM", 1, 3);
+  sensor.begin();
+  CHECK(sensor.probes_found == 3);
+
+  // One Convert T For All, A Scratchpad Read Each
+  std::string json = read(sensor);
+  CHECK(json == "\"SWTM 1\":20.0,\"SWTM 2\":22.0,\"SWTM 3\":21.5,");
+  CHECK(water.conversions == root_zone.conversions);
+  CHECK(water.reads == 1 && root_zone.reads == 1 && drain.reads == 1);
+  CHECK(sensor.crc_errors == 0);
+  hostAttachPinDevice(5, NULL);
+}
+
+static void checkTwoBuses(void) {
+  // The Water Probe & A Root Zone Probe On Pin 5, The Other Root Zone Probe On Pin 2
+  HostOneWireBus first_bus, second_bus;
+  HostDs18b20 water(0x0000A1B2C3D4ULL), root_zone(0x000051F00D01ULL, 1.5), drain(0x0000E7C0FFEEULL, 2);
+  first_bus.attach(&water);
+  first_bus.attach(&root_zone);
+  second_bus.attach(&drain);
+  hostAttachPinDevice(5, &first_bus);
+  hostAttachPinDevice(2, &second_bus);
+  const uint8_t pins[] = {5, 2}; // both on port e
+  SensorDs18b20 sensor(pins, 2, "SWTM", 1, 3);
+  sensor.begin();
+  CHECK(sensor.probes_found == 3);
+
+  // Numbered Bus By Bus, Convert T On Both At Once
+  CHECK(read(sensor) == "\"SWTM 1\":20.0,\"SWTM 2\":21.5,\"SWTM 3\":22.0,");
+  CHECK(water.conversions == drain.conversions);
+
+  // Reads Of Both Buses Run At Once, A Sample Takes The Reads Of The Busier Bus
+  uint64_t two_bus_us = sample(sensor);
+  CHECK(water.reads == drain.reads);
+
+  // The Same Probes On One Bus Take A Read More
+  HostOneWireBus one_bus;
+  one_bus.attach(&water);
+  one_bus.attach(&root_zone);
+  one_bus.attach(&drain);
+  hostAttachPinDevice(5, &one_bus);
+  SensorDs18b20 one_bus_sensor(5, "SWTM", 1, 3);
+  one_bus_sensor.begin();
+  sample(one_bus_sensor);
+  uint64_t one_bus_us = sample(one_bus_sensor);
+  CHECK(two_bus_us < one_bus_us);
+  hostAttachPinDevice(5, NULL);
+  hostAttachPinDevice(2, NULL);
+}
+
+static void checkProbePluggedInLater(void) {
+  // Two Of Three Probes On Pin 6 At First, The Missing One Is Reported
+  HostOneWireBus bus;
+  HostDs18b20 water(0x0000A1B2C3D4ULL), root_zone(0x000051F00D01ULL, 1.5), drain(0x0000E7C0FFEEULL, 2);
+  bus.attach(&water);
+  bus.attach(&drain);
+  hostAttachPinDevice(6, &bus);
+  SensorDs18b20 sensor(6, "SWTM", 1, 3);
+  sensor.begin();
+  CHECK(sensor.probes_found == 2);
+  CHECK(read(sensor) == "\"GERR 12\":\"ds18b20 not found\",\"SWTM 1\":20.0,\"SWTM 2\":22.0,");
+
+  // The Third Takes The Free Id, The Others Keep Theirs
+  bus.attach(&root_zone);
+  for (uint8_t n = 0; n < 20 && sensor.probes_found < 3; n++) {
+    read(sensor);
+  }
+  CHECK(sensor.probes_found == 3);
+  CHECK(read(sensor) == "\"SWTM 1\":20.0,\"SWTM 2\":22.0,\"SWTM 3\":21.5,");
+
+  // Searching Again On "SWTM 1 0" Keeps Every Id
+  sensor.set("SWTM", 1, "0");
+  CHECK(read(sensor) == "\"SWTM 1\":20.0,\"SWTM 2\":22.0,\"SWTM 3\":21.5,");
+  hostAttachPinDevice(6, NULL);
+}
+
+//--------------------------------------------------MAIN---------------------------------------------//
+int main(void) {
+  host_environment.water_temperature = 20;
+  checkOneBus();
+  checkProbePluggedInLater();
+  checkTwoBuses();
+  return finishTest("test_ds18b20");
+}
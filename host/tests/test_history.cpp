@@ -0,0 +1,87 @@
+/**
+ *  \file test_history.cpp
+ *  \brief Host test of the history frames (see support_history.h).
+ *  \details Records readings sampled out of order and far apart, then checks that the size
+ *  sizeFrame() declares is the number of bytes printFrame() prints, and that the frame
+ *  passes the size and checksum checks of the controller with every record in it.
+ *  \author Jake Rye
+ */
+#include <string>
+
+#include "Arduino.h"
+#include "host_controller.h"
+#include "support_history.h"
+#include "host_test.h"
+
+#define SOH 1
+#define STX 2
+#define ETX 3
+#define EOT 4
+
+/**
+ * \brief Collects what is printed to it.
+ */
+class StringPrint : public Print {
+  public:
+    size_t write(uint8_t c) {
+      text += (char)c;
+      return 1;
+    }
+    std::string text;
+};
+
+static KeyDictionary keys;
+static SyncedClock clock_;
+static SampleHistory history(keys, clock_);
+
+//-------------------------------------------------PRIVATE-------------------------------------------//
+static void checkFrame(uint32_t first, uint8_t expected_count) {
+  // Declared Size Matches The Bytes Printed
+  uint8_t count = 0;
+  uint16_t size = history.sizeFrame(first, count);
+  StringPrint frame;
+  history.printFrame(frame, first, count);
+  CHECK(count == expected_count);
+  CHECK(size == frame.text.length());
+
+  // Controller Reads The Frame By Its Declared Size
+  HostController controller;
+  std::string packed;
+  packed += (char)SOH;
+  packed += std::to_string(size);
+  packed += (char)STX;
+  packed += frame.text;
+  packed += (char)ETX;
+  packed += std::to_string(HostController::checksum(frame.text));
+  packed += (char)EOT;
+  for (size_t i = 0; i < packed.length(); i++) {
+    controller.onBoardByte(packed[i]);
+  }
+  CHECK(controller.bad_frames == 0);
+  CHECK(controller.history_frames == 1);
+  CHECK(controller.history_records == count);
+}
+
+//--------------------------------------------------MAIN---------------------------------------------//
+int main(void) {
+  keys.add(packCode("SATM"), 1);
+  keys.add(packCode("SWTM"), 1);
+
+  // Readings Out Of Order, e.g. A Background Read Recorded After A Later One
+  long values[] = {2210, 2230, 1980, 2250, 2000, 2270};
+  uint32_t times[] = {1000, 3000, 2500, 5000, 4000, 200000};
+  for (uint8_t n = 0; n < 6; n++) {
+    history.time = times[n];
+    history.add((n % 2) ? "SWTM" : "SATM", 1, values[n], 2);
+  }
+  checkFrame(history.begin(), 6);
+  checkFrame(history.begin() + 2, 4);
+
+  // Back In Time By More Than A Long Gap
+  history.time = 1000;
+  history.add("SATM", 1, 2100, 2);
+  history.time = 300000;
+  history.add("SATM", 1, 2150, 2);
+  checkFrame(history.begin(), 8);
+  return finishTest("test_history");
+}
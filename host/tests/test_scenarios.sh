@@ -0,0 +1,202 @@
+#!/bin/sh
+# Host scenario tests: runs build/gro_host with the arguments of each scenario and
+# checks its report for the lines expected. Run by "make test" from host/.
+
+HOST=./build/gro_host
+failures=0
+
+# expect <description> <pattern> <gro_host arguments>...
+expect() {
+  description=$1
+  pattern=$2
+  shift 2
+  if "$HOST" "$@" | grep -q -- "$pattern"; then
+    echo "passed: $description"
+  else
+    echo "FAILED: $description (no \"$pattern\" in: $HOST $*)"
+    failures=$((failures + 1))
+  fi
+}
+
+# expect_none <description> <pattern> <gro_host arguments>...
+expect_none() {
+  description=$1
+  pattern=$2
+  shift 2
+  if "$HOST" "$@" | grep -q -- "$pattern"; then
+    echo "FAILED: $description (\"$pattern\" in: $HOST $*)"
+    failures=$((failures + 1))
+  else
+    echo "passed: $description"
+  fi
+}
+
+# expect_at_most <description> <name> <limit> <gro_host arguments>...
+# Checks the first <name>=<value> of the report is at most limit.
+expect_at_most() {
+  description=$1
+  name=$2
+  limit=$3
+  shift 3
+  value=$("$HOST" "$@" | sed -n "s/^[a-z0-9]*:.* $name=\([0-9]*\).*/\1/p" | head -n 1)
+  if [ -n "$value" ] && [ "$value" -le "$limit" ]; then
+    echo "passed: $description"
+  else
+    echo "FAILED: $description ($name=$value, limit $limit, in: $HOST $*)"
+    failures=$((failures + 1))
+  fi
+}
+
+# expect_same <description> <sed script> <sed script> <gro_host arguments>...
+# Checks the numbers the two sed scripts take from the report are the same.
+expect_same() {
+  description=$1
+  first_script=$2
+  second_script=$3
+  shift 3
+  report=$("$HOST" "$@")
+  first=$(echo "$report" | sed -n "$first_script" | head -n 1)
+  second=$(echo "$report" | sed -n "$second_script" | head -n 1)
+  if [ -n "$first" ] && [ "$first" = "$second" ]; then
+    echo "passed: $description"
+  else
+    echo "FAILED: $description ($first and $second, in: $HOST $*)"
+    failures=$((failures + 1))
+  fi
+}
+
+# expect_count <description> <pattern> <count> <gro_host arguments>...
+# Checks count lines of the report match pattern.
+expect_count() {
+  description=$1
+  pattern=$2
+  count=$3
+  shift 3
+  value=$("$HOST" "$@" | grep -c -- "$pattern")
+  if [ "$value" -eq "$count" ]; then
+    echo "passed: $description"
+  else
+    echo "FAILED: $description ($value lines of \"$pattern\", expected $count, in: $HOST $*)"
+    failures=$((failures + 1))
+  fi
+}
+
+expect "history download after the ring filled" "bad_frames=0" --hours 0.2 --send-at 600 "GHST 1 0"
+expect "dictionary before the first reading has the precision of every code" '\["SWTM",1,"C",1\]' \
+  --cycles 1 --echo --send-at 0 "GDSC 1 1"
+expect_at_most "the dictionary is printed into the frame, not built on the heap" peak_heap_bytes 512 \
+  --cycles 3 --send "GDSC 1 1"
+expect "streams with key numbers decode to the keys of the dictionary" \
+  '^{"GTYP":"Stream","SWPH 1":6.0,"SWEC 1":1.5,"SWTM 1":19.3,"SLIN 1":31,"SLPA 1":0.69,"SATM 1":19.2,.*"ALMI 1":1,"GEND":0},$' \
+  --cycles 2 --echo --send "GDSC 1 1"
+expect "binary streams with key numbers decode to the keys of the dictionary" \
+  '^{"GTYP":"Stream","SWPH 1":6.0,"SWEC 1":1.5,"SWTM 1":19.3,"SLIN 1":31,"SLPA 1":0.69,"SATM 1":19.2,.*"ALMI 1":1,"GEND":0},$' \
+  --cycles 2 --echo --send "GDSC 1 1" --send "GFMT 1 1"
+# Ten streams with full keys and the dictionary take 3195 bytes
+expect_at_most "streams with key numbers are smaller than with full keys" tx_bytes 2500 --cycles 10 --send "GDSC 1 1"
+expect_at_most "profiles are printed into the frame, not built on the heap" peak_heap_bytes 512 \
+  --cycles 3 --send "GPRF 1 1"
+expect "1-wire transactions are not cut by SoftwareSerial at the fastest rates" "ds18b20:.* crc_errors=0 " \
+  --hours 0.05 --send "GRAT 0 100"
+expect "DHT22 reads do not lose edges to SoftwareSerial at the fastest rates" "dht22:.* timeouts=0 " \
+  --hours 0.05 --send "GRAT 0 100"
+expect "DHT22 reads do not lose edges to 1-wire searches" "dht22:.* timeouts=0 " \
+  --hours 0.05 --send "GRAT 0 100" --ds18b20-probes 0
+expect_at_most "buses without probes are searched every few reads, not on every read" searches 50 \
+  --hours 0.1 --send "GRAT 0 100" --ds18b20-probes 0
+expect "buses without probes are searched again" "ds18b20:.* searches=[1-9][0-9]" \
+  --hours 0.1 --send "GRAT 0 100" --ds18b20-probes 0
+expect_same "a DHT22 is read on every update the scheduler makes" \
+  's/^dht22 1: transfers=\([0-9]*\).*/\1/p' 's/^SensorDht22::update() *[a-z]* *\([0-9]*\).*/\1/p' --hours 1 --summary
+# The water temperature is 19.3 C at the start, the probe swapped in is 10 C warmer
+expect_none "the first water temperatures are not averaged with 0" '"SWTM 1":[0-9]\.' --cycles 5 --echo
+expect_none "a probe that takes the id of another is not averaged with its readings" '"SWTM 1":2[2-8]\.' \
+  --hours 0.1 --echo --ds18b20-swap-at 60
+expect "water temperatures that fail every CRC are not passed off as new samples" '"GTIM 3":1[0-9][0-9]\.' \
+  --hours 0.05 --sync 60 --echo --ds18b20-errors 1
+expect "a DHT22 never read is left out, not reported as 0" \
+  '"GERR 15":"dht22 timeout","SACO 1"' --cycles 2 --echo --dht22-sensors 0
+
+expect "instructions reach only the module of their code and id" '"GTYP":"Stream",.*"ALPN 1":0,"ALPN 2":1' \
+  --cycles 2 --echo --send "ALPN 2 1"
+expect "instructions for an id no module has are rejected" \
+  '{"GTYP":"Response","GERR 6":"unknown instruction AAHE 2","GEND":0}' --cycles 2 --echo --send "AAHE 2 1"
+
+expect "the board settles on the highest rate the controller accepts" "^setup:.* baud=57600" \
+  --cycles 1 --max-baud 57600
+expect "streams arrive at the rate negotiated" '"GTYP":"Stream","SWPH 1":6.0' \
+  --cycles 2 --echo --max-baud 1000000 --link-baud 250000
+expect "a link slower than every offer falls back to the handshake rate" "^setup:.* baud=9600" \
+  --cycles 1 --link-baud 38400
+expect "streams arrive at the handshake rate after the fallback" '"GTYP":"Stream","SWPH 1":6.0' \
+  --cycles 2 --echo --link-baud 38400
+expect "a controller that does not negotiate is kept at the handshake rate" "^setup:.* baud=9600" \
+  --cycles 1 --max-baud 0
+
+expect "streams between keyframes leave out readings that did not change" '{"GTYP":"Stream","GEND":0}' \
+  --cycles 3 --echo --send "GCHG 1 3"
+expect_count "a keyframe with every reading is sent every keyframe period" '"GTYP":"Stream","SWPH 1"' 3 \
+  --cycles 7 --echo --send "GCHG 1 3"
+# The air cools by 0.4 C in half an hour, SATM 1 is sent 5 times without a deadband
+expect_count "readings within their deadband are only sent in keyframes" '"SATM 1":' 1 \
+  --hours 0.5 --echo --send "GCHG 1 10000" --send "GDBD 1 SATM 5"
+
+expect "GFMT returns the codes in the order binary records number them" \
+  '"GFMT 1":{"format":1,"codes":\["AACR","AAHE","AAHU","AAVE","ALMI","ALPN","GTIM","SACO",' --cycles 2 --echo --send "GFMT 1 1"
+expect "binary streams decode to the readings of a JSON stream" \
+  '^{"GTYP":"Stream","SWPH 1":6.0,"SWEC 1":1.5,"SWTM 1":19.3,"SLIN 1":31,"SLPA 1":0.69,"SATM 1":19.2,.*"ALMI 1":1,"GEND":0},$' \
+  --cycles 2 --echo --send "GFMT 1 1"
+# Three JSON streams take 813 bytes
+expect_at_most "binary streams are smaller than JSON" tx_bytes 500 --cycles 3 --send "GFMT 1 1"
+
+expect "streams are timestamped with controller time once the clock is set" \
+  '^{"GTYP":"Stream","GTIM 1":17[0-9]\{8\},"GTIM 2":0\.[0-9]*,"GTIM 3":[0-9.]*,"SWPH 1":' --cycles 3 --sync 60 --echo
+expect "the board learns a clock running fast" '"GTIM 1":{"syncs":12,"offset":-\?[01],"drift":50\.0,' \
+  --hours 1 --sync 300 --clock-drift 50 --echo --send-at 3500 "GTIM 1 0"
+expect "the board learns a clock running slow" '"GTIM 1":{"syncs":12,"offset":-\?[01],"drift":-[78][0-9]\.[0-9],' \
+  --hours 1 --sync 300 --clock-drift -80 --echo --send-at 3500 "GTIM 1 0"
+
+# The water is at 19.3 C, which 9 bits (0.5 C steps) read as 19.0
+expect "probes set to 9 bits read in 0.5 C steps" '"SWTM 1":19.0' --hours 0.05 --echo --send "SWTM 1 9"
+expect "9 bit conversions lower the minimum period" '"GRAT 3":{"name":"SWTM 1","sample":1000,"report":1000,"minimum":124}' \
+  --cycles 3 --echo --send "SWTM 1 9" --send-at 4 "GRAT 3 1000"
+expect "11 bit conversions lower the minimum period" '"GRAT 3":{"name":"SWTM 1","sample":1000,"report":1000,"minimum":405}' \
+  --cycles 3 --echo --send "SWTM 1 11" --send-at 4 "GRAT 3 1000"
+expect "resolutions other than 9 to 12 bits are ignored" '"GRAT 3":{"name":"SWTM 1","sample":1000,"report":1000,"minimum":780}' \
+  --cycles 3 --echo --send "SWTM 1 13" --send-at 4 "GRAT 3 1000"
+
+# The air is at 19.2 C and 57.1 % at the start
+expect "a DHT22 twice as fast as nominal is decoded" '"SATM 1":19.2,"SAHU 1":57.1,' \
+  --cycles 2 --echo --dht22-timing 50
+expect "a DHT22 twice as slow as nominal is decoded" '"SATM 1":19.2,"SAHU 1":57.1,' \
+  --cycles 2 --echo --dht22-timing 200
+expect "the bit threshold follows a fast DHT22" "^dht22:.* checksum_errors=0 timeouts=0 " --hours 0.02 --dht22-timing 50
+expect "the bit threshold is the measured bit low" "^dht22 1:.* bit_low=25 zero_high=13 one_high=35" \
+  --cycles 2 --dht22-timing 50
+
+# 32 deadbands of unknown keys, as many as the change filter tracks, then a known one
+set --
+for id in $(seq 1 32); do
+  set -- "$@" --send-at "$id" "GDBD $id XXXX 1"
+done
+expect "deadbands of unknown keys are rejected without taking a slot" '"GDBD SATM 1":0.50' \
+  --hours 0.01 --echo "$@" --send-at 33 "GDBD 1 SATM 0.5"
+expect "negative rates are rejected" '"GERR 5":"invalid rate instruction"' --cycles 2 --echo --send "GRAT 3 -5"
+expect "negative report periods are rejected" '"GERR 5":"invalid rate instruction"' \
+  --cycles 2 --echo --send "GRAT 3 5000 -1"
+expect "rates below the minimum of the module are rejected" '"GERR 5":"invalid rate instruction"' \
+  --cycles 2 --echo --send "GRAT 3 100"
+expect_at_most "rates of every module are printed into the frame, not built on the heap" peak_heap_bytes 512 \
+  --cycles 3 --send "GRAT 0 2000"
+expect "rates of at least the minimum are set" '"GRAT 3":{"name":"SWTM 1","sample":1000,"report":1000' \
+  --cycles 2 --echo --send "GRAT 3 1000"
+expect "GRAT 0 sets every module, raising the sample period to its minimum" \
+  '"GRAT 1":{"name":"SWPH 1","sample":100,"report":100,"minimum":100}.*"GRAT 5":{"name":"SATM 1","sample":2000,"report":2000,"minimum":2000}.*"GRAT 15":{"name":"ALMI 1","sample":100,' \
+  --cycles 2 --echo --send "GRAT 0 100"
+expect "report periods are set apart from sample periods" '"GRAT 9":{"name":"AAHE 1","sample":2000,"report":10000,' \
+  --cycles 2 --echo --send "GRAT 9 2000 10000"
+# Sent 1 s in, so the heater is next reported 11 s in, within the 10 streams of 20 s
+expect_count "a module is streamed every report period only" '"GTYP":"Stream",.*"AAHE 1":' 1 \
+  --cycles 10 --echo --send "GRAT 9 2000 10000"
+
+[ "$failures" -eq 0 ]
@@ -18,20 +18,8 @@ void ActuatorRelay::begin(void) {
  turnOff();
 }
 
-String ActuatorRelay::get(void) {
-  // Initialize Message
-  String message = "";
-
-  // Append Actuator State
-  message += "\"";
-  message += instruction_code_;
-  message += " ";
-  message += instruction_id_;
-  message += "\":";
-  message += value_;
-  message += ",";
-  
-  return message;
+void ActuatorRelay::print(MessageWriter &message) {
+  message.add(instruction_code_.c_str(), instruction_id_, (long)value_);
 }
 
 String ActuatorRelay::set(String instruction_code, int instruction_id, String instruction_parameter) {
@@ -18,7 +18,7 @@
 /**
  * \brief Actuator module for an active low SPST-NO relay.
  */
-class ActuatorRelay : SensorActuatorModule {
+class ActuatorRelay : public SensorActuatorModule {
   //------------------------------------------------PUBLIC---------------------------------------------//
   public:
     /* Public Functions */
@@ -46,11 +46,11 @@ class ActuatorRelay : SensorActuatorModule {
     void begin(void); 
 
     /**
-     * \brief Returns JSON string with module data.
+     * \brief Appends JSON key value pairs with the latest module data to message.
      * Data: "<instruction_code> <instruction_id> <value>",
      * Example: "AAHU 1 1",
      */
-    String get(void); 
+    void print(MessageWriter &message); 
 
     /**
      * \brief Sets relay to be on / off.
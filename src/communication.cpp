@@ -6,9 +6,32 @@
  */
 #include "communication.h"
 
+// Dallas CRC8 (x^8 + x^5 + x^4 + 1, reflected), Same Table As support_one_wire.cpp
+static const uint8_t PROGMEM kChecksumTable[] = {
+      0, 94,188,226, 97, 63,221,131,194,156,126, 32,163,253, 31, 65,
+    157,195, 33,127,252,162, 64, 30, 95,  1,227,189, 62, 96,130,220,
+     35,125,159,193, 66, 28,254,160,225,191, 93,  3,128,222, 60, 98,
+    190,224,  2, 92,223,129, 99, 61,124, 34,192,158, 29, 67,161,255,
+     70, 24,250,164, 39,121,155,197,132,218, 56,102,229,187, 89,  7,
+    219,133,103, 57,186,228,  6, 88, 25, 71,165,251,120, 38,196,154,
+    101, 59,217,135,  4, 90,184,230,167,249, 27, 69,198,152,122, 36,
+    248,166, 68, 26,153,199, 37,123, 58,100,134,216, 91,  5,231,185,
+    140,210, 48,110,237,179, 81, 15, 78, 16,242,172, 47,113,147,205,
+     17, 79,173,243,112, 46,204,146,211,141,111, 49,178,236, 14, 80,
+    175,241, 19, 77,206,144,114, 44,109, 51,209,143, 12, 82,176,238,
+     50,108,142,208, 83, 13,239,177,240,174, 76, 18,145,207, 45,115,
+    202,148,118, 40,171,245, 23, 73,  8, 86,180,234,105, 55,213,139,
+     87,  9,235,181, 54,104,138,212,149,203, 41,119,244,170, 72, 22,
+    233,183, 85, 11,136,214, 52,106, 43,117,151,201, 74, 20,246,168,
+    116, 42,200,150, 21, 75,169,247,182,232, 10, 84,215,137,107, 53};
+
+// Baud Rates Offered To The Controller, Highest First
+static const uint32_t kBaudRateOffers[] = {1000000, 500000, 250000, 115200, 57600};
+
 void Communication::begin(void) {
   kBaudRate = 9600;
   kEstablishConnectionTimeout = 2000; // milliseconds
+  kNegotiationTimeout = 100; // milliseconds
   kReceiveTimeout = 5000; // milliseconds
   kStartOfHeaderChar = 1;
   kStartOfTextChar = 2;
@@ -16,6 +39,18 @@ void Communication::begin(void) {
   kEndOfTransmissionChar = 4;
   kEnquireChar = 5;
   kAcknowledgeChar = 6; 
+  kNegativeAcknowledgeChar = 21;
+  kBaudRateOfferChar = 17;
+  baud_rate_ = kBaudRate;
+  receive_state_ = kAwaitHeader;
+  receive_length_ = 0;
+  received_frames_ = 0;
+  rejected_frames_ = 0;
+  receive_latency_ = 0;
+  frame_bytes_ = 0;
+  receive_frame_bytes_ = 0;
+  last_poll_time_ = micros();
+  receive_poll_time_ = last_poll_time_;
   
   Serial.begin(kBaudRate);
   Serial.write(kEnquireChar);  // send enquiry
@@ -25,185 +60,261 @@ void Communication::begin(void) {
       if (Serial.read() == kAcknowledgeChar) { // await acknowledgement
         Serial.write(kAcknowledgeChar); // acknowledge acknowledgementq
         not_connected_ = 0;
+        negotiateBaudRate();
         return; // connected!
       }
     }
     if (millis() - start_time > kEstablishConnectionTimeout) {
-      String connection_error_message = "Did not establish connection with rPi";
+      String connection_error_message = F("Did not establish connection with rPi");
       Serial.println(connection_error_message);
       not_connected_ = 1;
+      receive_state_ = kReadLine;
       break; // timed out :(
     }
   }
 }
 
-void Communication::send(String outgoing_message) {
-  outgoing_message = "{" + outgoing_message + "},";
-  
-  if (not_connected_) {
-    Serial.println(outgoing_message);
+void Communication::send(const String &message) {
+  beginFrame(message.length());
+  print(message);
+  endFrame();
+}
+
+void Communication::beginFrame(uint16_t message_size, bool binary) {
+  // Send Header
+  binary_frame_ = binary;
+  if (!not_connected_) { // connected to rPi
+    Serial.write(kStartOfHeaderChar);
+    Serial.print(binary ? message_size : message_size + 3); // {},
+    Serial.write(kStartOfTextChar);
   }
-  else { // Connected to rPi
-    String packed_message = getPackedMessage(outgoing_message);
-    Serial.print(packed_message);
+
+  // Start Message
+  frame_checksum_ = 0x00;
+  if (!binary_frame_) {
+    write('{');
   }
 }
 
-bool Communication::available(void) {
-  if (Serial.available()) {
-    return 1;
+void Communication::endFrame(void) {
+  // Finish Message
+  if (!binary_frame_) {
+    write('}');
+    write(',');
   }
-  else {
-    return 0;
+
+  // Send Footer
+  if (not_connected_) {
+    Serial.println();
+  }
+  else { // connected to rPi
+    Serial.write(kEndOfTextChar);
+    Serial.print(frame_checksum_);
+    Serial.write(kEndOfTransmissionChar);
   }
 }
 
-String Communication::receive(void) { 
-  String incoming_message = "";
-  char incoming_char;
-  bool timed_out = 0;
-  uint32_t start_time = millis();
+size_t Communication::write(uint8_t c) {
+  frame_checksum_ = updateChecksum(frame_checksum_, c);
+  return Serial.write(c);
+}
 
-  // Handle Incoming Messages
-  while (1) {
-    delay(10);
-    incoming_char = Serial.read();
+uint32_t Communication::getMessageAge(void) {
+  // A Frame Read Late Is Read Faster Than It Came Over The Wire, Its Start Was Earlier
+  uint32_t wire_time = receive_frame_bytes_ * 10000000UL / baud_rate_; // 10 bits per byte
+  uint32_t age = micros() - receive_start_;
+  if (wire_time > receive_latency_) {
+    age += wire_time - receive_latency_;
+  }
+  return age;
+}
 
-    if (not_connected_ && (incoming_char == '\n')) {
-      break;
+uint32_t Communication::getMessageAgeError(void) {
+  // The Message Started After The Poll Before Its Start Of Header Was Read
+  uint32_t age = getMessageAge();
+  uint32_t oldest = micros() - receive_poll_time_;
+  return (oldest > age) ? oldest - age : 0;
+}
+
+uint32_t Communication::getBaudRate(void) {
+  return baud_rate_;
+}
+
+void Communication::negotiateBaudRate(void) {
+  int offers = sizeof(kBaudRateOffers) / sizeof(kBaudRateOffers[0]);
+  for (int i = 0; i < offers; i++) {
+    // Offer Rate
+    Serial.write(kBaudRateOfferChar);
+    Serial.print(kBaudRateOffers[i]);
+    Serial.write(kEndOfTransmissionChar);
+    int reply = awaitReply(kNegotiationTimeout);
+    if (reply < 0) {
+      return; // controller does not negotiate, stay at handshake rate
     }
-    if (!not_connected_ && (incoming_char == kEndOfTransmissionChar)) {
-      break;
+    if (reply == kNegativeAcknowledgeChar) {
+      continue; // refused, offer next rate
     }
-    
-    incoming_message += incoming_char;
-    
-    if (millis() - start_time > kReceiveTimeout) {
-      timed_out = 1;
-      break;
+
+    // Switch & Confirm Rate
+    Serial.flush();
+    Serial.begin(kBaudRateOffers[i]);
+    Serial.write(kEnquireChar);
+    if (awaitReply(kNegotiationTimeout) == kAcknowledgeChar) {
+      Serial.write(kAcknowledgeChar); // acknowledge acknowledgement
+      baud_rate_ = kBaudRateOffers[i];
+      return; // settled!
     }
-  }
-  if (not_connected_) {
-    if (timed_out) {
-      incoming_message = "Timed Out";
+
+    // Fall Back To Handshake Rate Once Controller Has Too
+    Serial.flush();
+    Serial.begin(kBaudRate);
+    delay(kNegotiationTimeout);
+    while (Serial.available()) {
+      Serial.read(); // garbled bytes
     }
-    return incoming_message;
-  }
-  else {
-    if (timed_out) {
-      return "";
-    } 
-    String unpacked_message =  getUnpackedMessage(incoming_message);
-    return unpacked_message;
   }
 }
 
-String Communication::getPackedMessage(String message) {
-  String packed_message = "";
-  String checksum = getChecksum(message);
-  packed_message += kStartOfHeaderChar; 
-  packed_message += message.length();
-  packed_message += kStartOfTextChar; 
-  packed_message += message;
-  packed_message += kEndOfTextChar; 
-  packed_message += checksum; 
-  packed_message += kEndOfTransmissionChar;
-  return packed_message;
-}
-
-String Communication::getChecksum(String message) {
-  byte crc = 0x00;
-  int len = message.length();
-  int counter = 0;
-  while (len--) {
-    byte extract = message.charAt(counter);
-    counter++;
-    for (byte tempI = 8; tempI; tempI--) {
-      byte sum = (crc ^ extract) & 0x01;
-      crc >>= 1;
-      if (sum) {
-        crc ^= 0x8C;
+int Communication::awaitReply(uint32_t timeout) {
+  // Wait For ACK Or NAK, Ignoring Anything Else
+  uint32_t start_time = millis();
+  while (millis() - start_time <= timeout) {
+    if (Serial.available()) {
+      int c = Serial.read();
+      if ((c == kAcknowledgeChar) || (c == kNegativeAcknowledgeChar)) {
+        return c;
       }
-      extract >>= 1;
     }
   }
-  return String(crc);
+  return -1;
 }
 
-String Communication::getUnpackedMessage(String message) {
-  // Check Start of Header
-  if (!checkStartOfHeader(message)) {
-    return "";
-  }
-  
-  // Parse Header
-  int message_size = parseHeader(message);
-  if (message_size < 0) {
-    return "";
+bool Communication::available(void) {
+  // Consume Whatever Has Arrived, One Message At A Time
+  while ((receive_state_ != kReady) && Serial.available()) {
+    receiveChar(Serial.read());
+    last_receive_time_ = millis();
   }
+  last_poll_time_ = micros(); // anything read later arrived after this
 
-  // Parse Text
-  String unpacked_message = parseText(message); 
-  if (unpacked_message == "") {
-    return "";
+  // Drop A Partial Frame Whose Remaining Bytes Never Came
+  bool partial = (receive_state_ != kAwaitHeader) && (receive_state_ != kReady) &&
+                 ((receive_state_ != kReadLine) || (receive_length_ > 0));
+  if (partial && (millis() - last_receive_time_ > kReceiveTimeout)) {
+    rejectMessage();
   }
+  return receive_state_ == kReady;
+}
 
-  // Check Message Size
-  if (message_size != unpacked_message.length()) {
-    return "";
-  }
-  
-  // Compute & Compare Checksums
-  String incoming_checksum = parseFooter(message);
-  String computed_checksum = getChecksum(unpacked_message);
-  if (incoming_checksum != computed_checksum) {
+String Communication::receive(void) { 
+  if (!available()) {
     return "";
   }
-  
-  // Received Valid Message
-  return unpacked_message;
+  String incoming_message = receive_buffer_;
+  receive_length_ = 0;
+  receive_state_ = not_connected_ ? kReadLine : kAwaitHeader;
+  return incoming_message;
 }
 
-bool Communication::checkStartOfHeader(String message) {
-  if (message[0] == kStartOfHeaderChar) {
-    return 1;
-  }
-  else {
-    return 0;
-  }
+void Communication::printReceiveStats(Print &out) {
+  out.print(F("{\"frames\":"));
+  out.print(received_frames_);
+  out.print(F(",\"rejected\":"));
+  out.print(rejected_frames_);
+  out.print(F(",\"latency\":"));
+  out.print(receive_latency_);
+  out.print('}');
 }
 
-int Communication::parseHeader(String message) {
-  int end_char = message.indexOf(kStartOfTextChar);
-  if (end_char < 0) {
-    return -1;
+void Communication::receiveChar(char c) {
+  // Start Over On Every Start Of Header
+  if ((c == kStartOfHeaderChar) && (receive_state_ != kReadLine)) {
+    if (receive_state_ != kAwaitHeader) {
+      rejected_frames_++;
+    }
+    receive_state_ = kReadSize;
+    receive_size_ = 0;
+    receive_start_ = micros();
+    receive_poll_time_ = last_poll_time_;
+    frame_bytes_ = 1;
+    return;
   }
-  return message.substring(1,end_char).toInt();
-}
+  frame_bytes_++;
 
-String Communication::parseText(String message) {
-  int start_char = message.indexOf(kStartOfTextChar) +1 ;
-  int end_char = message.indexOf(kEndOfTextChar);
-  if (end_char < 0) {
-    return "";
-  }
-  if (end_char <= start_char) {
-    return "";
-  }
-  return message.substring(start_char,end_char);
-}
+  switch (receive_state_) {
+    case kReadSize: // SOH<message_size>STX
+      if ((c >= '0') && (c <= '9') && (receive_size_ <= kReceiveBufferSize)) {
+        receive_size_ = receive_size_ * 10 + (c - '0');
+      }
+      else if ((c == kStartOfTextChar) && (receive_size_ > 0) && (receive_size_ <= kReceiveBufferSize)) {
+        receive_state_ = kReadText;
+        receive_length_ = 0;
+        computed_checksum_ = 0x00;
+      }
+      else {
+        rejectMessage();
+      }
+      break;
 
-String Communication::parseFooter(String message) {
-  int start_char = message.indexOf(kEndOfTextChar) + 1;
-  int end_char = message.length();
-  if (end_char < 0) {
-    return "";
-  }
-  if (end_char <= start_char) {
-    return "";
+    case kReadText: // <message>ETX
+      if (c == kEndOfTextChar) {
+        if (receive_length_ == receive_size_) {
+          receive_state_ = kReadChecksum;
+          receive_checksum_ = 0;
+        }
+        else {
+          rejectMessage();
+        }
+      }
+      else if (receive_length_ < receive_size_) {
+        receive_buffer_[receive_length_++] = c;
+        computed_checksum_ = updateChecksum(computed_checksum_, c);
+      }
+      else {
+        rejectMessage();
+      }
+      break;
+
+    case kReadChecksum: // <message_checksum>EOT
+      if ((c >= '0') && (c <= '9') && (receive_checksum_ <= 255)) {
+        receive_checksum_ = receive_checksum_ * 10 + (c - '0');
+      }
+      else if ((c == kEndOfTransmissionChar) && (receive_checksum_ == computed_checksum_)) {
+        receive_latency_ = micros() - receive_start_;
+        receive_frame_bytes_ = frame_bytes_;
+        acceptMessage();
+      }
+      else {
+        rejectMessage();
+      }
+      break;
+
+    case kReadLine: // not connected, <message>\n
+      if ((c == '\n') && (receive_length_ > 0)) {
+        acceptMessage();
+      }
+      else if ((c != '\n') && (c != '\r') && (receive_length_ < kReceiveBufferSize)) {
+        receive_buffer_[receive_length_++] = c;
+      }
+      break;
+
+    default: // kAwaitHeader, ignore anything outside a frame
+      break;
   }
-  return message.substring(start_char,end_char);
 }
 
+void Communication::acceptMessage(void) {
+  receive_buffer_[receive_length_] = '\0';
+  receive_state_ = kReady;
+  received_frames_++;
+}
 
+void Communication::rejectMessage(void) {
+  receive_length_ = 0;
+  receive_state_ = not_connected_ ? kReadLine : kAwaitHeader;
+  rejected_frames_++;
+}
 
+uint8_t Communication::updateChecksum(uint8_t crc, uint8_t c) {
+  return pgm_read_byte(kChecksumTable + (crc ^ c));
+}
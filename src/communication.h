@@ -3,6 +3,18 @@
  *  \brief Handles a character based serial communication protocol.
  *  \details Uses ascii control codes and checksum. Protocol for a
  *  packed message: SOH<message_size>STX<message>ETX<message_checksum>EOT
+ *  Outgoing messages are framed on the fly: beginFrame() sends the header, every byte
+ *  printed to the Communication object goes straight to the serial port and into the
+ *  checksum, and endFrame() sends the footer. No copy of the message is ever made. The
+ *  checksum is the Dallas CRC8, computed one byte at a time with a 256 byte table in
+ *  program memory. Incoming frames are parsed the same way: available() feeds whatever
+ *  bytes the serial port holds through a state machine and never waits for the rest of
+ *  a frame, so a frame is read at line rate while loop() keeps running.
+ *  The link starts at 9600 baud. After the ENQ/ACK handshake the board offers faster
+ *  rates, highest first, as DC1<baud_rate>EOT. The controller answers ACK and switches,
+ *  or NAK to refuse. Both ends then confirm the new rate with another ENQ/ACK, or go back
+ *  to 9600 after kNegotiationTimeout, and the board offers the next rate. A controller
+ *  that does not answer the first offer keeps the link at 9600.
  *  \author Jake Rye
  */
 #ifndef COMMUNICATION_H
@@ -17,37 +29,121 @@
 /** 
  *  \brief Handles a character based serial communication protocol. 
  */
-class Communication {
+class Communication : public Print {
   public:
     // Public Functions
     void begin(void);
-    void send(String message);
+
+    /**
+     * \brief Sends message as a single frame: {<message>},
+     */
+    void send(const String &message);
+
+    /**
+     * \brief Starts a frame for a message of message_size characters.
+     * The message is then printed to this object and the frame finished with endFrame().
+     * The size does not include the {}, added around the message. Binary messages are
+     * framed as they are, without the {},.
+     */
+    void beginFrame(uint16_t message_size, bool binary = false);
+
+    /**
+     * \brief Finishes the frame started with beginFrame().
+     */
+    void endFrame(void);
+
+    /**
+     * \brief Sends c to the serial port and adds it to the checksum of the current frame.
+     */
+    size_t write(uint8_t c);
+    using Print::write;
+
+    /**
+     * \brief Reads the bytes the serial port holds, without waiting for more.
+     * Returns true once a complete, valid message has been received.
+     */
     bool available(void);
+
+    /**
+     * \brief Returns the message received by available() and frees the receiver for
+     * the next one. Returns "" if no message is ready.
+     */
     String receive(void);
+
+    /**
+     * \brief Prints the receive statistics to out.
+     * Example: {"frames":3,"rejected":0,"latency":15632}
+     * latency is the number of microseconds from SOH to EOT of the last valid frame.
+     */
+    void printReceiveStats(Print &out);
+
+    /**
+     * \brief Returns the number of microseconds since the start of the last message
+     * received, so a time sent by the controller can be dated back to when it was sent.
+     * A frame that was read faster than its bytes take on the wire waited in the serial
+     * buffer, its age is counted from when its first byte must have arrived.
+     */
+    uint32_t getMessageAge(void);
+
+    /**
+     * \brief Returns the number of microseconds the last message may be older than
+     * getMessageAge(): how long the serial port went unread before its start of header was
+     * read, less what the wire time accounts for. Large while loop() was blocked.
+     */
+    uint32_t getMessageAgeError(void);
+
+    /**
+     * \brief Returns the baud rate the link settled on in begin().
+     */
+    uint32_t getBaudRate(void);
     
     // Public Variables
     bool not_connected_;
 
   private:
     // Private Functions
-    String getPackedMessage(String message);
-    String getChecksum(String message);
-    String getUnpackedMessage(String message);
-    bool checkStartOfHeader(String message);
-    int parseHeader(String message);
-    String parseText(String message);
-    String parseFooter(String message);
+    void negotiateBaudRate(void);
+    int awaitReply(uint32_t timeout);
+    void receiveChar(char c);
+    void acceptMessage(void);
+    void rejectMessage(void);
+    uint8_t updateChecksum(uint8_t crc, uint8_t c);
     
     // Private Variables
-    uint32_t kBaudRate;
+    uint32_t kBaudRate; // handshake & fallback rate
     uint32_t kEstablishConnectionTimeout; // milliseconds
-    uint32_t kReceiveTimeout; // milliseconds
+    uint32_t kNegotiationTimeout; // milliseconds, for an answer to an offer & for confirming it
+    uint32_t kReceiveTimeout; // milliseconds, a partial frame is dropped after this long without a byte
     char kStartOfHeaderChar;
     char kStartOfTextChar;
     char kEndOfTextChar;
     char kEndOfTransmissionChar;
     char kEnquireChar;
     char kAcknowledgeChar; 
+    char kNegativeAcknowledgeChar;
+    char kBaudRateOfferChar;
+    uint32_t baud_rate_;
+    uint8_t frame_checksum_;
+    bool binary_frame_;
+
+    // Receive State
+    static const uint8_t kReceiveBufferSize = 64; // characters, longest incoming message
+    enum ReceiveState {kAwaitHeader, kReadSize, kReadText, kReadChecksum, kReadLine, kReady};
+    ReceiveState receive_state_;
+    char receive_buffer_[kReceiveBufferSize + 1];
+    uint8_t receive_length_;
+    uint16_t receive_size_; // from the header
+    uint16_t receive_checksum_; // from the footer
+    uint8_t computed_checksum_;
+    uint32_t receive_start_; // micros() at SOH
+    uint32_t last_receive_time_; // millis() at the last byte
+    uint32_t received_frames_;
+    uint32_t rejected_frames_;
+    uint32_t receive_latency_; // microseconds
+    uint16_t frame_bytes_; // bytes of the frame being received, from SOH
+    uint16_t receive_frame_bytes_; // bytes of the last valid frame
+    uint32_t last_poll_time_; // micros() when available() last left the serial buffer empty
+    uint32_t receive_poll_time_; // last_poll_time_ before the SOH of the last frame was read
 };
 
 #endif // COMMUNICATION_H_
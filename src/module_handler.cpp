@@ -8,6 +8,9 @@
 
 // Include Module Libraries
 #include "communication.h"
+#include "support_clock.h"
+#include "support_history.h"
+#include "support_time.h"
 //#include "sensor_dfr0161_0300.h"
 #include "sensor_vernier_ph.h"
 #include "sensor_vernier_ec.h"
@@ -26,7 +29,14 @@ SensorTsl2561 sensor_tsl2561_light_intensity_default("SLIN", 1, "SLPA", 1);
 SensorVernierPh sensor_venier_ph_default(A1, "SWPH", 1);
 SensorVernierEc sensor_vernier_ec_default(A2, "SWEC", 1);
 SensorDs18b20 sensor_ds18b20_water_temperature(5, "SWTM", 1);
-SensorDht22 sensor_dht22_air_temperature_humidity_default(A0, "SATM", 1, "SAHU", 1);
+// Water & 2 root zone probes as SWTM 1 to 3, on a 1-wire bus per tank read in lockstep (pins of one port, e here):
+//const uint8_t kWaterTemperaturePins[] = {5, 2};
+//SensorDs18b20 sensor_ds18b20_water_temperature(kWaterTemperaturePins, 2, "SWTM", 1, 3);
+SensorDht22 sensor_dht22_air_temperature_humidity_default(A0, "SATM", 1, "SAHU", 1); // no interrupt, polled read
+// Canopy top & bottom as SATM/SAHU 1 & 3, read at once in the background on interrupts 4 & 5 (pins of port d):
+//const uint8_t kAirPins[] = {19, 18};
+//const uint8_t kAirIds[] = {1, 3}; // SATM 2 & SAHU 2 are the gc0011's
+//SensorDht22 sensor_dht22_air_temperature_humidity_default(kAirPins, kAirIds, 2, "SATM", "SAHU");
 SensorGc0011 sensor_gc0011_air_co2_temperature_humidity_default(12, 11, "SACO", 1, "SATM", 2, "SAHU", 2);
 SensorContactSwitch sensor_contact_switch_general_shell_open_default(4, "SGSO", 1);
 SensorContactSwitch sensor_contact_switch_general_window_open_default(3, "SGWO", 1);
@@ -38,72 +48,428 @@ ActuatorRelay actuator_relay_air_circulation_default(15, "AACR", 1);
 ActuatorRelay actuator_relay_light_chamber_illumination_default(53, "ALPN", 2); 
 ActuatorRelay actuator_relay_light_motherboard_illumination_default(52, "ALMI", 1);
 
+// Module Registry, In Stream Order. Adding a module only takes an entry here.
+RegisteredModule modules[] = {
+  //{"SWPH 1", &sensor_dfr01610300_water_ph_temperature_ec_default},
+  {"SWPH 1", &sensor_venier_ph_default},
+  {"SWEC 1", &sensor_vernier_ec_default},
+  {"SWTM 1", &sensor_ds18b20_water_temperature},
+  //{"SWTM 1", &sensor_ds18b20_water_temperature, "SWTM 2,SWTM 3"}, // with the root zone probes
+  {"SLIN 1", &sensor_tsl2561_light_intensity_default, "SLPA 1"},
+  {"SATM 1", &sensor_dht22_air_temperature_humidity_default, "SAHU 1"},
+  //{"SATM 1", &sensor_dht22_air_temperature_humidity_default, "SAHU 1,SATM 3,SAHU 3"}, // with the canopy bottom
+  {"SACO 1", &sensor_gc0011_air_co2_temperature_humidity_default, "SATM 2,SAHU 2"},
+  {"SGSO 1", &sensor_contact_switch_general_shell_open_default},
+  {"SGWO 1", &sensor_contact_switch_general_window_open_default},
+  {"AAHE 1", &actuator_relay_air_heater_default},
+  {"AAHU 1", &actuator_relay_air_humidifier_default},
+  {"AAVE 1", &actuator_relay_air_vent_default},
+  {"AACR 1", &actuator_relay_air_circulation_default},
+  {"ALPN 1", &actuator_relay_light_panel_default},
+  {"ALPN 2", &actuator_relay_light_chamber_illumination_default},
+  {"ALMI 1", &actuator_relay_light_motherboard_illumination_default},
+};
+const int kModules = sizeof(modules) / sizeof(modules[0]);
+
+// Instruction Routing Table, Sorted By Code Then ID. Built From The Registry At Startup.
+struct InstructionRoute {
+  uint32_t code; // 4 characters packed first character highest, so sorting is alphabetical
+  int id;
+  uint8_t module; // index in modules[]
+};
+const int kMaxRoutes = 32;
+InstructionRoute routes[kMaxRoutes];
+int route_count = 0;
+
+// Scheduling State
+const uint32_t kDefaultPeriod = 2000; // milliseconds, sample & report period of every module at startup
+const uint32_t kMinimumPeriod = 100; // milliseconds
+
+// Units & Precision Of The Instruction Codes, Sent With The Key Dictionary
+struct CodeUnit {
+  const char *code;
+  const char *unit;
+  uint8_t decimals; // readings of the code are streamed & recorded with this many decimals
+};
+const CodeUnit kCodeUnits[] = {
+  {"SWPH", "pH", 1}, {"SWEC", "mS/cm", 1}, {"SWTM", "C", 1}, {"SLIN", "lux", 0}, {"SLPA", "umol/m2/s", 2},
+  {"SATM", "C", 1}, {"SAHU", "%", 1}, {"SACO", "ppm", 0}, {"GTIM", "s", 0}
+}; // every other code is a switch or relay state, 0 or 1
+const int kCodeUnitCount = sizeof(kCodeUnits) / sizeof(kCodeUnits[0]);
+
+// Profiling State
+bool stream_profiles = false;
+uint32_t profile_deadline;
+
+// Printed Response State, Responses Too Long For A String Are Printed Into The Frame
+const uint8_t kProfileResponse = 0x01; // GPRF
+const uint8_t kRateResponse = 0x02; // GRAT
+const uint8_t kDictionaryResponse = 0x04; // GDSC
+uint8_t printed_responses = 0; // requested by the messages handled this pass
+int rate_response_module = 0; // module of the GRAT response, 0 for every module
+
+// Change Only Streaming State
+ChangeFilter change_filter;
+uint16_t keyframe_period = 0; // streams, 0 sends every reading in every stream
+uint16_t streams_since_keyframe = 0;
+
+// Stream Format State
+CodeTable stream_codes; // every code of the routing table
+KeyDictionary stream_keys; // every key of the routing table, sent to the controller with GDSC
+bool indexed_keys = false; // controller has the dictionary
+const uint16_t kCodeListSize = 7 * kMaxRoutes + 3; // bytes, "CODE", per route & []
+bool binary_streams = false;
+
+// Time Sync State
+SyncedClock controller_clock;
+const uint32_t kSyncInterval = 60; // seconds, support_time reads controller_clock this often
+const uint32_t kSyncTimeout = 86400; // seconds without a GTIM before support_time reports timeNeedsSync
+const uint32_t kMaxSyncError = 5; // milliseconds, a GTIM read later than this after it may have arrived is ignored
+
+// Sample History State
+SampleHistory sample_history(stream_keys, controller_clock); // numbers keys as the dictionary does
+bool history_download = false;
+uint32_t history_cursor; // sequence number of the next record to send
+int rollup_download = -1; // tier of the rollup frame to send
+uint8_t rollup_rows;
+
+// Private Functions
+void beginModule(RegisteredModule &entry);
+void updateModule(RegisteredModule &entry);
+String setModule(RegisteredModule &entry, Instruction instruction);
+uint32_t getMinimumPeriod(RegisteredModule &entry);
+void setPeriods(RegisteredModule &entry, uint32_t sample_period, uint32_t report_period);
+void printModuleProfile(Print &out, RegisteredModule &entry);
+void buildRoutes(void);
+void addRoute(const char *key, uint8_t module);
+int findRoute(uint32_t code, int id);
+bool isDue(uint32_t deadline, uint32_t now);
+void advanceDeadline(uint32_t &deadline, uint32_t period, uint32_t now);
+void sendPrintedMessage(const __FlashStringHelper *type, const String &responses, uint8_t printed);
+void printMessageFrame(Print &out, const __FlashStringHelper *type, const String &responses, uint8_t printed);
+void sendStreamMessage(uint32_t now);
+void printStreamMessage(Print &out, uint32_t now, ChangeFilter *filter);
+void printDueModules(MessageWriter &writer, uint32_t now);
+void printStreamTime(MessageWriter &writer, uint32_t now);
+void recordHistory(RegisteredModule &entry);
+void sendHistoryFrame(void);
+void sendRollupFrame(void);
+time_t getControllerTime(void);
+const char *getCodeUnit(uint32_t code);
+uint8_t getCodeDecimals(uint32_t code);
+
+void SensorActuatorModule::update(void) {
+}
+
+bool SensorActuatorModule::finishUpdate(void) {
+  return true;
+}
+
+bool SensorActuatorModule::hasNewReading(void) {
+  return true;
+}
+
+bool SensorActuatorModule::needsInterrupts(void) {
+  return false;
+}
+
+bool SensorActuatorModule::masksInterrupts(void) {
+  return false;
+}
+
+uint32_t SensorActuatorModule::getMinimumPeriod(void) {
+  return 0;
+}
+
+void SensorActuatorModule::print(MessageWriter &message) {
+  if (!message.binary() && !message.recording()) { // get() is JSON, left out of binary streams & the history
+    message.out.print(get());
+  }
+}
+
+String SensorActuatorModule::get(void) {
+  char buffer[96];
+  MessageBuffer message_buffer(buffer, sizeof(buffer));
+  MessageWriter message(message_buffer);
+  update();
+  print(message);
+  return String(buffer);
+}
+
 void initializeModules(void) { 
   communication.begin();
-  //sensor_dfr01610300_water_ph_temperature_ec_default.begin();
-  sensor_venier_ph_default.begin();
-  sensor_vernier_ec_default.begin();
-  sensor_ds18b20_water_temperature.begin();
-  sensor_tsl2561_light_intensity_default.begin();
-  sensor_dht22_air_temperature_humidity_default.begin();
-  sensor_gc0011_air_co2_temperature_humidity_default.begin();
-  sensor_contact_switch_general_shell_open_default.begin();
-  sensor_contact_switch_general_window_open_default.begin();
-  actuator_relay_air_heater_default.begin();
-  actuator_relay_air_humidifier_default.begin();
-  actuator_relay_air_vent_default.begin();
-  actuator_relay_air_circulation_default.begin();
-  actuator_relay_light_panel_default.begin();
-  actuator_relay_light_chamber_illumination_default.begin();
-  actuator_relay_light_motherboard_illumination_default.begin();
+  for (int i = 0; i < kModules; i++) {
+    beginModule(modules[i]);
+  }
+  buildRoutes();
 
   // Set Default States
   actuator_relay_air_circulation_default.set("AACR", 1, "1");
   actuator_relay_light_motherboard_illumination_default.set("ALMI", 1, "1");
   actuator_relay_air_vent_default.set("AAVE", 1, "1");
+
+  // Schedule First Readings Now & First Reports One Period Later
+  uint32_t now = millis();
+  for (int i = 0; i < kModules; i++) {
+    setPeriods(modules[i], kDefaultPeriod, kDefaultPeriod);
+    modules[i].sample_deadline = now;
+    modules[i].sample_time = now;
+    modules[i].sampling = false;
+    modules[i].report_deadline = now + modules[i].report_period;
+  }
+  profile_deadline = now + kDefaultPeriod;
 }
 
 void updateIncomingMessage(void) {
+  // Return Early When Idle, Runs On Every Pass Of loop()
+  if (!communication.available()) {
+    return;
+  }
+
   // Check for Message(s) And Handle If Necessary
   String response_message = "";
-  while (communication.available()) { // read in message(s) until nothing in serial buffer
+  while (communication.available()) { // handle message(s) until no complete one is left
     response_message += handleIncomingMessage();
   }
-  // Append Responses From Message(s) Then Send
-  if (response_message != "") {
-    response_message = "\"GTYP\":\"Response\"," + response_message;
-    response_message += "\"GEND\":0";
+  // Append Responses From Message(s) Then Send, Long Responses Are Printed Into The Frame
+  if (printed_responses) {
+    sendPrintedMessage(F("Response"), response_message, printed_responses);
+    printed_responses = 0;
+  }
+  else if (response_message != "") {
+    response_message = String(F("\"GTYP\":\"Response\",")) + response_message;
+    response_message += F("\"GEND\":0");
     communication.send(response_message);
   }
 }
 
+void updateModules(void) {
+  // Record Readings Finished In The Background, As Taken Now So The History Stays In Order
+  bool interrupts_needed = false;
+  for (int i = 0; i < kModules; i++) {
+    if (modules[i].sampling && modules[i].module->finishUpdate()) {
+      modules[i].sampling = false;
+      if (modules[i].module->hasNewReading()) {
+        modules[i].sample_time = millis();
+        recordHistory(modules[i]);
+      }
+    }
+    interrupts_needed |= modules[i].sampling && modules[i].module->needsInterrupts();
+  }
+
+  // Find Most Overdue Module, Not Still Sampling Nor Turning Off Interrupts Another Needs
+  uint32_t now = millis();
+  RegisteredModule *due_module = NULL;
+  uint32_t due_lateness = 0;
+  for (int i = 0; i < kModules; i++) {
+    int32_t lateness = (int32_t)(now - modules[i].sample_deadline);
+    if (interrupts_needed && modules[i].module->masksInterrupts()) {
+      continue; // run once the background reading is past its timed part
+    }
+    if (lateness >= 0 && !modules[i].sampling && (due_module == NULL || (uint32_t)lateness > due_lateness)) {
+      due_module = &modules[i];
+      due_lateness = lateness;
+    }
+  }
+  if (due_module == NULL) {
+    return;
+  }
+
+  // Run Module & Schedule Next Reading, A Reading Kept From Before Keeps Its Time
+  updateModule(*due_module);
+  due_module->sampling = !due_module->module->finishUpdate();
+  if (!due_module->sampling && due_module->module->hasNewReading()) {
+    due_module->sample_time = now;
+    recordHistory(*due_module);
+  }
+  advanceDeadline(due_module->sample_deadline, due_module->sample_period, now);
+}
+
 void updateStreamMessage(void) {
-  // Initialize Stream Message
-  String stream_message = "\"GTYP\":\"Stream\",";
-
-  // Get Stream Message
-  //stream_message += sensor_dfr01610300_water_ph_temperature_ec_default.get();
-  stream_message += sensor_venier_ph_default.get();
-  stream_message += sensor_vernier_ec_default.get();
-  stream_message += sensor_ds18b20_water_temperature.get();
-  stream_message += sensor_tsl2561_light_intensity_default.get();
-  stream_message += sensor_dht22_air_temperature_humidity_default.get(); // does not work on 1.0
-  stream_message += sensor_gc0011_air_co2_temperature_humidity_default.get();
-  stream_message += sensor_contact_switch_general_shell_open_default.get();
-  stream_message += sensor_contact_switch_general_window_open_default.get();
-  stream_message += actuator_relay_air_heater_default.get();
-  stream_message += actuator_relay_air_humidifier_default.get();
-  stream_message += actuator_relay_air_vent_default.get();
-  stream_message += actuator_relay_air_circulation_default.get();
-  stream_message += actuator_relay_light_panel_default.get();
-  stream_message += actuator_relay_light_chamber_illumination_default.get();
-  stream_message += actuator_relay_light_motherboard_illumination_default.get();
-
-  // Return Stream Message
-  stream_message += "\"GEND\":0";
-
-  // Send Stream Message
-  communication.send(stream_message);
+  // Check If Any Report Is Due
+  uint32_t now = millis();
+  bool profiles_due = stream_profiles && isDue(profile_deadline, now);
+  bool reports_due = false;
+  bool samples_due = false;
+  for (int i = 0; i < kModules; i++) {
+    if (isDue(modules[i].report_deadline, now)) {
+      reports_due = true;
+      // Sample First If Due Too, So Readings Are Fresh & Their Timestamps Close Together
+      samples_due |= (isDue(modules[i].sample_deadline, now) &&
+                      !isDue(modules[i].report_deadline, modules[i].sample_time)) ||
+                     modules[i].sampling;
+    }
+  }
+  if (reports_due && !samples_due) {
+    sendStreamMessage(now);
+  }
+
+  // Send Profiles If Requested
+  if (profiles_due) {
+    sendPrintedMessage(F("Stream"), "", kProfileResponse);
+    advanceDeadline(profile_deadline, kDefaultPeriod, now);
+  }
+
+  // Send History Requested With GHST, One Frame Per Pass
+  if (history_download) {
+    sendHistoryFrame();
+  }
+  else if (rollup_download >= 0) {
+    sendRollupFrame();
+  }
+}
+
+void sendPrintedMessage(const __FlashStringHelper *type, const String &responses, uint8_t printed) {
+  // Size Message, Then Print It Straight To The Serial Port
+  MessageCounter counter;
+  printMessageFrame(counter, type, responses, printed);
+  communication.beginFrame(counter.length());
+  printMessageFrame(communication, type, responses, printed);
+  communication.endFrame();
+}
+
+void printMessageFrame(Print &out, const __FlashStringHelper *type, const String &responses, uint8_t printed) {
+  out.print(F("\"GTYP\":\""));
+  out.print(type);
+  out.print(F("\","));
+  out.print(responses);
+  if (printed & kRateResponse) {
+    for (int i = 0; i < kModules; i++) {
+      if ((rate_response_module == 0) || (rate_response_module == i + 1)) {
+        printRateMessage(out, i + 1);
+      }
+    }
+  }
+  if (printed & kDictionaryResponse) {
+    printDictionaryMessage(out);
+  }
+  if (printed & kProfileResponse) {
+    printProfileMessage(out);
+  }
+  out.print(F("\"GEND\":0"));
+}
+
+void sendStreamMessage(uint32_t now) {
+  // Leave Out Unchanged Readings Between Keyframes
+  ChangeFilter *filter = NULL;
+  if (keyframe_period > 0) {
+    filter = &change_filter;
+    change_filter.keyframe = (streams_since_keyframe == 0);
+    streams_since_keyframe = (streams_since_keyframe + 1) % keyframe_period;
+  }
+
+  // Size Stream Message, print() Writes The Same Reading Until The Next update()
+  MessageCounter counter;
+  change_filter.record = false;
+  printStreamMessage(counter, now, filter);
+
+  // Send Stream Message Straight To The Serial Port
+  communication.beginFrame(counter.length(), binary_streams);
+  change_filter.record = true;
+  printStreamMessage(communication, now, filter);
+  communication.endFrame();
+
+  // Schedule Next Reports
+  for (int i = 0; i < kModules; i++) {
+    if (isDue(modules[i].report_deadline, now)) {
+      advanceDeadline(modules[i].report_deadline, modules[i].report_period, now);
+    }
+  }
+}
+
+void printStreamMessage(Print &out, uint32_t now, ChangeFilter *filter) {
+  KeyDictionary *keys = indexed_keys ? &stream_keys : NULL;
+  CodeTable *codes = binary_streams ? &stream_codes : NULL;
+  MessageWriter writer(out, filter, codes, keys);
+  MessageWriter time_writer(out, NULL, codes, keys); // timestamps are never left out
+  if (binary_streams) {
+    out.write(kBinaryStream);
+    printStreamTime(time_writer, now);
+    printDueModules(writer, now);
+  }
+  else {
+    out.print(F("\"GTYP\":\"Stream\","));
+    printStreamTime(time_writer, now);
+    printDueModules(writer, now);
+    out.print(F("\"GEND\":0"));
+  }
+}
+
+void printDueModules(MessageWriter &writer, uint32_t now) {
+  for (int i = 0; i < kModules; i++) {
+    if (isDue(modules[i].report_deadline, now)) {
+      modules[i].module->print(writer);
+    }
+  }
+}
+
+void recordHistory(RegisteredModule &entry) {
+  // Record Latest Readings, print() Does Not Resample
+  MessageCounter counter;
+  MessageWriter writer(counter, NULL, NULL, NULL, &sample_history);
+  sample_history.time = entry.sample_time;
+  entry.module->print(writer);
+}
+
+void sendHistoryFrame(void) {
+  // Skip Records Overwritten Since The Download Started
+  if ((int32_t)(history_cursor - sample_history.begin()) < 0) {
+    history_cursor = sample_history.begin();
+  }
+  if (history_cursor == sample_history.end()) {
+    history_download = false;
+    return;
+  }
+
+  // Send Next Frame Of Records
+  uint8_t count;
+  uint16_t size = sample_history.sizeFrame(history_cursor, count);
+  communication.beginFrame(size, true);
+  sample_history.printFrame(communication, history_cursor, count);
+  communication.endFrame();
+  history_cursor += count;
+}
+
+void sendRollupFrame(void) {
+#if SAMPLE_ROLLUP
+  // Send Summaries Requested With GHST In One Frame
+  SampleRollup &rollup = sample_history.rollup;
+  communication.beginFrame(rollup.sizeFrame(rollup_download, rollup_rows), true);
+  rollup.printFrame(communication, rollup_download, rollup_rows);
+  communication.endFrame();
+#endif
+  rollup_download = -1;
+}
+
+void printStreamTime(MessageWriter &writer, uint32_t now) {
+  // Find Oldest & Newest Sample Of The Stream
+  if (!controller_clock.isSet()) {
+    return;
+  }
+  uint32_t oldest_age = 0;
+  uint32_t newest_age = 0xFFFFFFFF;
+  for (int i = 0; i < kModules; i++) {
+    if (isDue(modules[i].report_deadline, now)) {
+      uint32_t age = now - modules[i].sample_time;
+      if (age > oldest_age) {
+        oldest_age = age;
+      }
+      if (age < newest_age) {
+        newest_age = age;
+      }
+    }
+  }
+  if (newest_age > oldest_age) {
+    return; // no reading due
+  }
+
+  // Append Controller Time Of Oldest Sample & Spread
+  uint32_t seconds;
+  uint16_t milliseconds;
+  controller_clock.getTime(now - oldest_age, seconds, milliseconds);
+  writer.add("GTIM", 1, (long)seconds);
+  writer.add("GTIM", 2, milliseconds / 1000.0, 3);
+  writer.add("GTIM", 3, (oldest_age - newest_age) / 1000.0, 3);
 }
 
 String handleIncomingMessage(void) {
@@ -114,26 +480,460 @@ String handleIncomingMessage(void) {
 
   // Pass Parsed Message To All Objects and Update Return Message if Applicable
   if (instruction.valid) {
-    //return_message += sensor_dfr01610300_water_ph_temperature_ec_default.set(instruction.code, instruction.id, instruction.parameter);
-    return_message += sensor_venier_ph_default.set(instruction.code, instruction.id, instruction.parameter);
-    return_message += sensor_vernier_ec_default.set(instruction.code, instruction.id, instruction.parameter);
-    return_message += sensor_ds18b20_water_temperature.set(instruction.code, instruction.id, instruction.parameter);
-    return_message += sensor_tsl2561_light_intensity_default.set(instruction.code, instruction.id, instruction.parameter);
-    return_message += sensor_dht22_air_temperature_humidity_default.set(instruction.code, instruction.id, instruction.parameter);
-    return_message += sensor_gc0011_air_co2_temperature_humidity_default.set(instruction.code, instruction.id, instruction.parameter);
-    return_message += sensor_contact_switch_general_shell_open_default.set(instruction.code, instruction.id, instruction.parameter);
-    return_message += sensor_contact_switch_general_window_open_default.set(instruction.code, instruction.id, instruction.parameter);
-    return_message += actuator_relay_air_heater_default.set(instruction.code, instruction.id, instruction.parameter);
-    return_message += actuator_relay_air_humidifier_default.set(instruction.code, instruction.id, instruction.parameter);
-    return_message += actuator_relay_air_vent_default.set(instruction.code, instruction.id, instruction.parameter);
-    return_message += actuator_relay_air_circulation_default.set(instruction.code, instruction.id, instruction.parameter);
-    return_message += actuator_relay_light_panel_default.set(instruction.code, instruction.id, instruction.parameter);
-    return_message += actuator_relay_light_chamber_illumination_default.set(instruction.code, instruction.id, instruction.parameter);
-    return_message += actuator_relay_light_motherboard_illumination_default.set(instruction.code, instruction.id, instruction.parameter);
+    if (instruction.code == "GPRF") {
+      return handleProfileInstruction(instruction);
+    }
+    if (instruction.code == "GRAT") {
+      return handleRateInstruction(instruction);
+    }
+    if (instruction.code == "GCHG") {
+      return handleChangeInstruction(instruction);
+    }
+    if (instruction.code == "GDBD") {
+      return handleDeadbandInstruction(instruction);
+    }
+    if (instruction.code == "GFMT") {
+      return handleFormatInstruction(instruction);
+    }
+    if (instruction.code == "GDSC") {
+      return handleDictionaryInstruction(instruction);
+    }
+    if (instruction.code == "GTIM") {
+      return handleTimeInstruction(instruction);
+    }
+    if (instruction.code == "GHST") {
+      return handleHistoryInstruction(instruction);
+    }
+    int route = findRoute(packCode(instruction.code.c_str()), instruction.id);
+    if (route < 0) {
+      return_message += F("\"GERR 6\":\"unknown instruction ");
+      return_message += instruction.code;
+      return_message += F(" ");
+      return_message += instruction.id;
+      return_message += F("\",");
+      return return_message;
+    }
+    RegisteredModule &entry = modules[routes[route].module];
+    return_message += setModule(entry, instruction);
+    setPeriods(entry, entry.sample_period, entry.report_period); // set() may have slowed the module
+    entry.sample_deadline = millis(); // refresh reading before next report
   }
   return return_message;
 }
 
+String handleProfileInstruction(Instruction instruction) {
+  // Update Profiling State
+  int parameter = instruction.parameter.toInt();
+  if (parameter == 0) {
+    stream_profiles = false;
+  }
+  else if (parameter == 1) {
+    stream_profiles = true;
+  }
+  else if (parameter == 2) {
+    for (int i = 0; i < kModules; i++) {
+      modules[i].update_profiler.reset();
+      modules[i].set_profiler.reset();
+    }
+  }
+
+  // Return Profiles With The Responses
+  printed_responses |= kProfileResponse;
+  return "";
+}
+
+void printProfileMessage(Print &out) {
+  for (int i = 0; i < kModules; i++) {
+    printModuleProfile(out, modules[i]);
+  }
+  out.print(F("\"GPRF COMM\":{\"baud\":"));
+  out.print(communication.getBaudRate());
+  out.print(F(",\"receive\":"));
+  communication.printReceiveStats(out);
+  out.print(F("},"));
+}
+
+String handleRateInstruction(Instruction instruction) {
+  // Parse Periods: <sample ms> [<report ms>], No Faster Than The Module Allows
+  long sample_period = instruction.parameter.toInt();
+  long report_period = sample_period;
+  int space = instruction.parameter.indexOf(' ');
+  if (space > 0) {
+    report_period = instruction.parameter.substring(space + 1).toInt();
+  }
+  if ((instruction.id < 0) || (instruction.id > kModules) || (sample_period < (long)kMinimumPeriod) ||
+      (report_period <= 0) ||
+      ((instruction.id > 0) && ((uint32_t)sample_period < getMinimumPeriod(modules[instruction.id - 1])))) {
+    return F("\"GERR 5\":\"invalid rate instruction\",");
+  }
+
+  // Update Affected Modules
+  uint32_t now = millis();
+  for (int i = 0; i < kModules; i++) {
+    if ((instruction.id == 0) || (instruction.id == i + 1)) {
+      setPeriods(modules[i], sample_period, report_period);
+      modules[i].sample_deadline = now;
+      modules[i].report_deadline = now + modules[i].report_period;
+    }
+  }
+
+  // Return Rates With The Responses, Of Every Module If Another Module Was Set This Pass
+  bool other_module = (printed_responses & kRateResponse) && (rate_response_module != instruction.id);
+  rate_response_module = other_module ? 0 : instruction.id;
+  printed_responses |= kRateResponse;
+  return "";
+}
+
+String handleChangeInstruction(Instruction instruction) {
+  // Parse Keyframe Period
+  long period = instruction.parameter.toInt();
+  if ((period < 0) || (period > 0xFFFF)) {
+    return F("\"GERR 7\":\"invalid change instruction\",");
+  }
+
+  // Update Streaming Mode, Next Stream Is A Keyframe
+  keyframe_period = period;
+  streams_since_keyframe = 0;
+
+  // Return Keyframe Period
+  String message = F("\"GCHG 1\":");
+  message += keyframe_period;
+  message += F(",");
+  return message;
+}
+
+String handleDeadbandInstruction(Instruction instruction) {
+  // Parse Code & Deadband: <code> <deadband>, Of A Key In The Routing Table
+  int space = instruction.parameter.indexOf(' ');
+  String code = instruction.parameter.substring(0, space);
+  float deadband = instruction.parameter.substring(space + 1).toFloat();
+  if ((space != 4) || (deadband < 0) || (findRoute(packCode(code.c_str()), instruction.id) < 0) ||
+      !change_filter.setDeadband(code.c_str(), instruction.id, deadband)) {
+    return F("\"GERR 7\":\"invalid change instruction\",");
+  }
+
+  // Return Deadband
+  String message = F("\"GDBD ");
+  message += code;
+  message += F(" ");
+  message += instruction.id;
+  message += F("\":");
+  message += String(deadband, 2);
+  message += F(",");
+  return message;
+}
+
+String handleFormatInstruction(Instruction instruction) {
+  // Parse Format: 0 JSON, 1 Binary
+  long format = instruction.parameter.toInt();
+  if ((format < 0) || (format > 1) || (format == 1 && communication.not_connected_)) {
+    return F("\"GERR 8\":\"invalid format instruction\",");
+  }
+
+  // Update Stream Format, Next Stream Is A Keyframe So No Reading Is Lost In The Switch
+  binary_streams = (format == 1);
+  streams_since_keyframe = 0;
+
+  // Return Format & Code Numbers
+  char buffer[kCodeListSize];
+  MessageBuffer codes(buffer, sizeof(buffer));
+  stream_codes.print(codes);
+  String message = F("\"GFMT 1\":{\"format\":");
+  message += format;
+  message += F(",\"codes\":");
+  message += buffer;
+  message += F("},");
+  return message;
+}
+
+String handleDictionaryInstruction(Instruction instruction) {
+  // Parse Mode: 0 Full Keys, 1 Key Numbers
+  long mode = instruction.parameter.toInt();
+  if ((mode < 0) || (mode > 1)) {
+    return F("\"GERR 9\":\"invalid dictionary instruction\",");
+  }
+
+  // Update Stream Keys, Next Stream Is A Keyframe
+  indexed_keys = (mode == 1);
+  streams_since_keyframe = 0;
+
+  // Return Dictionary With The Responses
+  printed_responses |= kDictionaryResponse;
+  return "";
+}
+
+void printDictionaryMessage(Print &out) {
+  // Print [code, id, unit, decimals] Per Key Number
+  out.print(F("\"GDSC 1\":{\"mode\":"));
+  out.print(indexed_keys ? 1 : 0);
+  out.print(F(",\"keys\":["));
+  for (uint8_t key = 0; key < stream_keys.size(); key++) {
+    out.print(key ? F(",[\"") : F("[\""));
+    for (int8_t shift = 24; shift >= 0; shift -= 8) {
+      char c = (stream_keys.code(key) >> shift) & 0xFF;
+      if (c) {
+        out.print(c);
+      }
+    }
+    out.print(F("\","));
+    out.print(stream_keys.id(key));
+    out.print(F(",\""));
+    out.print(getCodeUnit(stream_keys.code(key)));
+    out.print(F("\","));
+    out.print(stream_keys.decimals(key));
+    out.print(']');
+  }
+  out.print(F("]},"));
+}
+
+String handleTimeInstruction(Instruction instruction) {
+  // Parse Time: <unix seconds> [<milliseconds>], 0 Only Returns Statistics
+  uint32_t seconds = strtoul(instruction.parameter.c_str(), NULL, 10);
+  long milliseconds = 0;
+  int space = instruction.parameter.indexOf(' ');
+  if (space > 0) {
+    milliseconds = instruction.parameter.substring(space + 1).toInt();
+  }
+  if ((instruction.id != 1) || (milliseconds < 0) || (milliseconds > 999)) {
+    return F("\"GERR 10\":\"invalid time instruction\",");
+  }
+
+  // Sync Clock At The Start Of The Frame, Support Time Follows It From Then On
+  bool late = communication.getMessageAgeError() > kMaxSyncError * 1000UL;
+  if ((seconds > 0) && !(late && controller_clock.isSet())) {
+    uint32_t sent_time = millis() - communication.getMessageAge() / 1000;
+    controller_clock.sync(seconds, milliseconds, sent_time);
+    setSyncProvider(getControllerTime);
+    setSyncInterval(kSyncInterval);
+  }
+
+  // Return Sync Statistics
+  String message = F("\"GTIM 1\":{\"syncs\":");
+  message += controller_clock.syncs;
+  message += F(",\"offset\":");
+  message += controller_clock.offset;
+  message += F(",\"drift\":");
+  message += String(controller_clock.drift, 1);
+  message += F(",\"status\":");
+  message += (int)timeStatus();
+  message += F("},");
+  return message;
+}
+
+String handleHistoryInstruction(Instruction instruction) {
+  // Parse Tier & Start Time: GHST <1 raw, 2 minutes, 3 hours> <unix seconds>, 0 For Everything
+  const int max_tier = SAMPLE_ROLLUP ? 3 : 1; // summaries only if the rollup is built in
+  if ((instruction.id < 1) || (instruction.id > max_tier) || !isdigit(instruction.parameter[0]) ||
+      communication.not_connected_) {
+    return F("\"GERR 11\":\"invalid history instruction\",");
+  }
+  uint32_t seconds = strtoul(instruction.parameter.c_str(), NULL, 10);
+
+  // Start Download, Frames Follow The Response
+  String message = F("\"GHST ");
+  message += instruction.id;
+  if (instruction.id == 1) {
+    history_cursor = sample_history.find(seconds);
+    history_download = true;
+    message += F("\":{\"records\":");
+    message += sample_history.end() - history_cursor;
+    message += F(",\"capacity\":");
+    message += SAMPLE_HISTORY_RECORDS;
+  }
+#if SAMPLE_ROLLUP
+  else {
+    rollup_download = instruction.id - 2;
+    rollup_rows = sample_history.rollup.countRows(rollup_download, seconds);
+    message += F("\":{\"rows\":");
+    message += rollup_rows;
+    message += F(",\"keys\":");
+    message += sample_history.rollup.getKeys();
+    message += F(",\"capacity\":");
+    message += (instruction.id == 2) ? ROLLUP_MINUTES : ROLLUP_HOURS;
+  }
+#endif
+
+  // Return Size Of The Download & RAM Used By The History
+  message += F(",\"memory\":");
+  message += sizeof(sample_history);
+  message += F("},");
+  return message;
+}
+
+time_t getControllerTime(void) {
+  // Sync Provider Of Support Time, 0 Once The Controller Has Not Synced For Too Long
+  uint32_t now = millis();
+  if (!controller_clock.isSet() || (controller_clock.getAge(now) > kSyncTimeout)) {
+    return 0;
+  }
+  uint32_t seconds;
+  uint16_t milliseconds;
+  controller_clock.getTime(now, seconds, milliseconds);
+  return seconds;
+}
+
+const char *getCodeUnit(uint32_t code) {
+  for (int i = 0; i < kCodeUnitCount; i++) {
+    if (packCode(kCodeUnits[i].code) == code) {
+      return kCodeUnits[i].unit;
+    }
+  }
+  return "bool";
+}
+
+uint8_t getCodeDecimals(uint32_t code) {
+  for (int i = 0; i < kCodeUnitCount; i++) {
+    if (packCode(kCodeUnits[i].code) == code) {
+      return kCodeUnits[i].decimals;
+    }
+  }
+  return 0;
+}
+
+void printRateMessage(Print &out, int module_number) {
+  RegisteredModule &entry = modules[module_number - 1];
+  out.print(F("\"GRAT "));
+  out.print(module_number);
+  out.print(F("\":{\"name\":\""));
+  out.print(entry.name);
+  out.print(F("\",\"sample\":"));
+  out.print(entry.sample_period);
+  out.print(F(",\"report\":"));
+  out.print(entry.report_period);
+  out.print(F(",\"minimum\":"));
+  out.print(getMinimumPeriod(entry));
+  out.print(F("},"));
+}
+
+void buildRoutes(void) {
+  // Add Name & Extra Keys Of Every Module
+  route_count = 0;
+  for (int i = 0; i < kModules; i++) {
+    addRoute(modules[i].name, i);
+    const char *key = modules[i].extra_keys;
+    while (key != NULL) {
+      addRoute(key, i);
+      key = strchr(key, ',');
+      if (key != NULL) {
+        key++;
+      }
+    }
+  }
+
+  // Number Codes & Keys For Binary & Indexed Streams, With The Precision Of Their Code
+  for (int i = 0; i < route_count; i++) {
+    stream_codes.add(routes[i].code);
+    stream_keys.add(routes[i].code, routes[i].id);
+  }
+  for (uint8_t key = 0; key < stream_keys.size(); key++) {
+    stream_keys.setDecimals(key, getCodeDecimals(stream_keys.code(key)));
+  }
+
+  // Number Stream Timestamps: Seconds, Fraction & Spread
+  uint32_t time_code = packCode("GTIM");
+  stream_codes.add(time_code);
+  for (int id = 1; id <= 3; id++) {
+    stream_keys.add(time_code, id);
+  }
+  stream_keys.setDecimals(stream_keys.find(time_code, 2), 3);
+  stream_keys.setDecimals(stream_keys.find(time_code, 3), 3);
+}
+
+void addRoute(const char *key, uint8_t module) {
+  // Parse Key: <code> <id>
+  if (route_count >= kMaxRoutes) {
+    return;
+  }
+  InstructionRoute route;
+  route.code = packCode(key);
+  route.id = atoi(key + 4);
+  route.module = module;
+
+  // Insert In Sorted Position
+  int i = route_count;
+  while ((i > 0) && ((routes[i - 1].code > route.code) ||
+         ((routes[i - 1].code == route.code) && (routes[i - 1].id > route.id)))) {
+    routes[i] = routes[i - 1];
+    i--;
+  }
+  routes[i] = route;
+  route_count++;
+}
+
+int findRoute(uint32_t code, int id) {
+  // Binary Search Routing Table
+  int low = 0;
+  int high = route_count - 1;
+  while (low <= high) {
+    int middle = (low + high) / 2;
+    InstructionRoute &route = routes[middle];
+    if ((route.code < code) || ((route.code == code) && (route.id < id))) {
+      low = middle + 1;
+    }
+    else if ((route.code == code) && (route.id == id)) {
+      return middle;
+    }
+    else {
+      high = middle - 1;
+    }
+  }
+  return -1;
+}
+
+bool isDue(uint32_t deadline, uint32_t now) {
+  return (int32_t)(now - deadline) >= 0; // rollover safe
+}
+
+void advanceDeadline(uint32_t &deadline, uint32_t period, uint32_t now) {
+  deadline += period;
+  if (isDue(deadline, now)) { // fell a full period behind, skip rather than burst
+    deadline = now + period;
+  }
+}
+
+void beginModule(RegisteredModule &entry) {
+  uint32_t start_time = micros();
+  entry.module->begin();
+  entry.begin_time = micros() - start_time;
+}
+
+void updateModule(RegisteredModule &entry) {
+  entry.update_profiler.start();
+  entry.module->update();
+  entry.update_profiler.stop();
+}
+
+String setModule(RegisteredModule &entry, Instruction instruction) {
+  entry.set_profiler.start();
+  String message = entry.module->set(instruction.code, instruction.id, instruction.parameter);
+  entry.set_profiler.stop();
+  return message;
+}
+
+uint32_t getMinimumPeriod(RegisteredModule &entry) {
+  uint32_t minimum = entry.module->getMinimumPeriod();
+  return (minimum > kMinimumPeriod) ? minimum : kMinimumPeriod;
+}
+
+void setPeriods(RegisteredModule &entry, uint32_t sample_period, uint32_t report_period) {
+  // Sample No Faster Than The Module Allows, Never Report The Same Sample Twice
+  uint32_t minimum = getMinimumPeriod(entry);
+  entry.sample_period = (sample_period < minimum) ? minimum : sample_period;
+  entry.report_period = (report_period < entry.sample_period) ? entry.sample_period : report_period;
+}
+
+void printModuleProfile(Print &out, RegisteredModule &entry) {
+  out.print(F("\"GPRF "));
+  out.print(entry.name);
+  out.print(F("\":{\"begin\":"));
+  out.print(entry.begin_time);
+  out.print(F(",\"update\":"));
+  entry.update_profiler.printStats(out);
+  out.print(F(",\"set\":"));
+  entry.set_profiler.printStats(out);
+  out.print(F("},"));
+}
+
 Instruction parseIncomingMessage(String message) {
   // Initialize Instruction
   Instruction instruction;
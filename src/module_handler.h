@@ -10,7 +10,10 @@
  * be the firmware for applicable sensor/actuator modules. It has been written 
  * in such a way that each new type of sensor and actuator is its own module. Each 
  * sensor/actuator module must contain a class with the following methods: void begin(void), 
- * String get(void), String set(String instruction_code, int instruction_id, String instruction_parameter).
+ * void update(void), void print(MessageWriter &message), 
+ * String set(String instruction_code, int instruction_id, String instruction_parameter).
+ * Older modules may implement String get(void) instead of update() and print(), their
+ * readings are only sent in JSON streams and are not recorded in the sample history.
  * The existance of these methods are enforced by using the SensorActuatorModule interface. Each 
  * sensor/actuator must also be instantiated such that its modularity is prioritized. For example,
  * passing in pins, instruction codes, and instruction ids (all parameters that are subject
@@ -29,6 +32,9 @@
  #include "WProgram.h"
 #endif
 
+#include "support_message.h"
+#include "support_profiler.h"
+
 /**
  * \brief Abstract class used as the interface for all Sensor Actuator Modules
  */
@@ -40,9 +46,56 @@ class SensorActuatorModule {
     virtual void begin(void) = 0;
     
     /**
-     * \brief Called once per loop iteration to update and report module data to controller.
+     * \brief Called by the scheduler to take a new reading.
+     * Does nothing by default, for modules that read in get().
+     */
+    virtual void update(void);
+
+    /**
+     * \brief Called on every pass after update() until it returns true, for modules that
+     * take their reading in the background (e.g. on a timer interrupt). The reading is
+     * recorded and streamed once it is done. Returns true by default.
+     */
+    virtual bool finishUpdate(void);
+
+    /**
+     * \brief Returns false if the last update() kept the previous reading, e.g. after a
+     * failed read, so it keeps the time it was sampled at and is not recorded again.
+     * Returns true by default.
+     */
+    virtual bool hasNewReading(void);
+
+    /**
+     * \brief Returns true while a reading in the background relies on interrupts running
+     * on time, e.g. the slots of a 1-wire transaction timed by Timer1. Modules that turn
+     * interrupts off (see masksInterrupts()) are not run meanwhile. Returns false by default.
+     */
+    virtual bool needsInterrupts(void);
+
+    /**
+     * \brief Returns true if update() turns interrupts off for long, e.g. for about 1 ms per
+     * byte sent or received with SoftwareSerial. Returns false by default.
+     */
+    virtual bool masksInterrupts(void);
+
+    /**
+     * \brief Appends the latest reading to message, without using the heap.
+     * Appends get() by default, for modules that only implement get().
      */
-    virtual String get(void) = 0;
+    virtual void print(MessageWriter &message);
+
+    /**
+     * \brief Compatibility shim: calls update() and returns what print() writes.
+     * Modules that implement neither update() nor print() override this instead.
+     */
+    virtual String get(void);
+
+    /**
+     * \brief Returns the shortest sample period in milliseconds the module can keep up
+     * with, e.g. the conversion time of a sensor. The scheduler never samples the module
+     * faster. 0 by default, for modules that read right away.
+     */
+    virtual uint32_t getMinimumPeriod(void);
 
     /**
      * \brief Called once per loop iteration to update module state.
@@ -51,24 +104,86 @@ class SensorActuatorModule {
     virtual String set(String instruction_code, int instruction_id, String instruction_parameter) = 0;
 };
 
+/**
+ * \brief An entry of the module registry in module_handler.cpp.
+ * Holds the module and everything module_handler keeps track of for it. Only the name,
+ * module and extra keys are given in the registry, initializeModules() sets the rest.
+ * @param name is the first instruction code and id of the module, e.g. "SWTM 1"
+ * @param module is the module object
+ * @param extra_keys lists the other instruction codes and ids of the module separated by
+ * commas, e.g. "SATM 2,SAHU 2", or is NULL. Instructions are only routed to a module
+ * under its name and extra keys.
+ * @param sample_period is the number of milliseconds between scheduled *.update() calls
+ * @param sample_deadline is the millis() at which the next *.update() is due
+ * @param report_period is the number of milliseconds between streams that include the reading
+ * @param report_deadline is the millis() at which the reading is next included in a stream
+ * @param sample_time is the millis() at which the latest *.update() that took a new reading
+ * started, or at which *.finishUpdate() returned true for readings taken in the background
+ * @param sampling is true until *.finishUpdate() returns true
+ * @param begin_time is the number of microseconds taken by *.begin()
+ * @param update_profiler times *.update() calls
+ * @param set_profiler times *.set() calls
+ */
+struct RegisteredModule {
+  const char *name;
+  SensorActuatorModule *module;
+  const char *extra_keys;
+  uint32_t sample_period;
+  uint32_t sample_deadline;
+  uint32_t report_period;
+  uint32_t report_deadline;
+  uint32_t sample_time;
+  bool sampling;
+  uint32_t begin_time;
+  ModuleProfiler update_profiler;
+  ModuleProfiler set_profiler;
+};
+
 /**
  * \brief Called once to initialize all modules.
  *  Runs once at the beginning of the program.
- *  Calls all module *.begin() functions
+ *  Calls *.begin() of every module in the registry
  */
 void initializeModules(void);
 
 /**
  * \brief Handles all incoming messages from the controller.
- * If new message is available, receive message and pass to handler function. 
- * If handler function returns response message, send out.
+ * Reads whatever bytes have arrived without waiting for the rest of a frame. Every
+ * complete message is passed to the handler function. If handler function returns
+ * response message, send out.
  */
 void updateIncomingMessage(void);
 
+/**
+ * \brief Cooperative scheduler for the module *.update() functions.
+ * Runs the update() of the module whose sample deadline is the most overdue and sets its
+ * next sample deadline one sample period later. Runs at most one module per call and
+ * returns immediately if none is due, so loop() gets back to the incoming messages between
+ * modules instead of after a full sweep. A module still sampling in the background is
+ * polled with finishUpdate() on every call and is not run again until it is done, other
+ * modules run meanwhile, except those that turn interrupts off while a module needs them
+ * (see needsInterrupts()).
+ */
+void updateModules(void);
+
 /**
  * \brief Handles all outgoing messages to the controller.
- * Polls all objects using their *.get() function and appends to message stream
- * Sends message stream to controller.
+ * Has every module whose report deadline has passed print its latest reading straight
+ * into a frame on the serial port. The readings are printed twice, first to a
+ * MessageCounter to get the frame size, so no copy of the stream is kept in RAM and
+ * its size is not limited. In change only mode (see handleChangeInstruction()) readings
+ * that have not changed since they were last sent are left out, except in keyframes.
+ * Streams are JSON, or binary records if requested with GFMT (see support_message.h).
+ * Once the controller has the key dictionary (see handleDictionaryInstruction()) keys are
+ * sent as their number. Once the controller has set the clock (see handleTimeInstruction())
+ * every stream starts with the controller time at which its oldest reading was sampled,
+ * as "GTIM 1":<unix seconds>,"GTIM 2":<fraction of a second>, and the number of seconds
+ * to the newest, as "GTIM 3":<seconds>. Every reading of the stream was sampled between
+ * GTIM 1 + GTIM 2 and that plus GTIM 3. A due stream waits until the modules in it that
+ * are due for a sample as well have taken it, so it never carries readings a period old.
+ * Returns immediately if none is due. With the default periods all modules are due
+ * together, every kDefaultPeriod. A history download requested with GHST is sent one frame
+ * per call. Profiles requested with GPRF are sent as a stream message of their own.
  */
 void updateStreamMessage(void);
 
@@ -90,12 +205,130 @@ struct Instruction {
 /**
  * \brief Messages from controller are handled by this function.
  * Each message is a single instruction string. Instruction string gets
- * broken into instruction code, id, and parameter. Passed in piecewise to 
- * <module>.set function. If a return message is generated from the 
- * <module>.set function, this function returns that message.
+ * broken into instruction code, id, and parameter. Passed in piecewise to
+ * the <module>.set function of the module that owns the code and id, found
+ * with a binary search of the routing table. The module is sampled again right
+ * away so the next stream reflects the instruction. If a return message is
+ * generated from the <module>.set function, this function returns that message.
+ * Unknown codes and ids return "GERR 6":"unknown instruction <code> <id>".
  */
 String handleIncomingMessage(void);
 
+/**
+ * \brief Handles the GPRF (profile) instruction.
+ * Parameter 1 appends module profiles to every stream message, 0 stops appending them,
+ * 2 clears the statistics. The current profiles of all modules are always sent after the
+ * other responses of the same pass, printed straight into the response frame. Returns "".
+ */
+String handleProfileInstruction(Instruction instruction);
+
+/**
+ * \brief Handles the GRAT (rate) instruction: GRAT <module> <sample ms> [<report ms>].
+ * Modules are numbered from 1 in stream order, see printRateMessage(). Sets the sample
+ * period of the module and its report period, which defaults to the sample period and is
+ * never shorter than it. Periods of 0 or less, or a sample period below the minimum of the
+ * module (see SensorActuatorModule::getMinimumPeriod(), at least 100 ms), return
+ * "GERR 5". Module 0 applies the periods to all modules, raising the sample period to the
+ * minimum of each, so GRAT 0 100 samples every module as fast as it allows. Samples the
+ * module right away. The rates of the affected modules, or of every module if several
+ * were set in the same pass, are printed straight into the response frame. Returns "".
+ * Example: GRAT 3 30000 makes the water temperature sample & report every 30 seconds.
+ */
+String handleRateInstruction(Instruction instruction);
+
+/**
+ * \brief Handles the GCHG (change only) instruction: GCHG 1 <keyframe streams>.
+ * With a keyframe period above 0 a stream only includes the readings that changed by more
+ * than their deadband since they were last sent, and every keyframe period streams a
+ * keyframe with all readings. 0 sends every reading in every stream, the default. The
+ * next stream is always a keyframe, so GCHG also requests one. Returns the keyframe period.
+ * Example: GCHG 1 30 sends a keyframe once a minute at the default report period.
+ */
+String handleChangeInstruction(Instruction instruction);
+
+/**
+ * \brief Handles the GDBD (deadband) instruction: GDBD <id> <code> <deadband>.
+ * Sets the smallest change of reading "<code> <id>" that is sent in change only mode, 0
+ * by default so that any change of the reported value is sent. Returns the deadband, or
+ * "GERR 7" if the key is not in the routing table.
+ * Example: GDBD 1 SATM 0.5 sends the air temperature once it moved more than 0.5 C.
+ */
+String handleDeadbandInstruction(Instruction instruction);
+
+/**
+ * \brief Handles the GFMT (format) instruction: GFMT 1 <format>.
+ * Format 0 sends JSON streams, the default, 1 sends binary streams: a kBinaryStream byte
+ * followed by one binary record per reading, see support_message.h. Responses and
+ * profiles stay JSON. The next stream is a keyframe. Returns the format and the codes in
+ * the order they are numbered in binary records. Only available when connected.
+ * Example: "GFMT 1":{"format":1,"codes":["AACR","AAHE",...]},
+ */
+String handleFormatInstruction(Instruction instruction);
+
+/**
+ * \brief Handles the GDSC (dictionary) instruction: GDSC 1 <mode>.
+ * Returns "" and has printDictionaryMessage() print the key dictionary straight into the
+ * response frame: every key of the routing table, numbered in sorted order, as [code,
+ * id, unit, decimals]. The unit and decimals of a key are those of its code in the table
+ * of codes in module_handler.cpp, so the dictionary is the same whether or not the
+ * modules have read anything yet. Mode 1 then sends keys as their number in streams
+ * (both JSON and binary), mode 0 sends full keys again, the default. Sent once per
+ * connection, the board starts with full keys after a reset. The next stream is a keyframe.
+ * Example: "GDSC 1":{"mode":1,"keys":[["AACR",1,"bool",0],...,["SATM",1,"C",1],...]},
+ */
+String handleDictionaryInstruction(Instruction instruction);
+
+/**
+ * \brief Prints the key dictionary and the key mode of streams to out, see
+ * handleDictionaryInstruction().
+ */
+void printDictionaryMessage(Print &out);
+
+/**
+ * \brief Handles the GTIM (time) instruction: GTIM 1 <unix seconds> [<milliseconds>].
+ * Sets the board clock to the controller time, dated back to the start of the frame, and
+ * learns the drift of the board clock from the offset found, see support_clock.h. Streams
+ * are timestamped from then on. Once the clock is set, a GTIM that waited in the serial
+ * buffer for an unknown time, more than kMaxSyncError, while loop() was busy is ignored
+ * and the number of syncs returned does not change. GTIM 1 0 only returns the sync
+ * statistics: the number of syncs, the milliseconds the board clock was ahead at the last
+ * sync, the drift in parts per million and the time status of support_time.
+ * Example: "GTIM 1":{"syncs":4,"offset":-3,"drift":41.5,"status":2},
+ */
+String handleTimeInstruction(Instruction instruction);
+
+/**
+ * \brief Handles the GHST (history) instruction: GHST <tier> <unix seconds>.
+ * Every sample is recorded in a ring in RAM and also summarized per minute and per hour,
+ * see support_history.h. GHST 1 starts sending the records sampled at or after the given
+ * time, 0 for every record, as binary history frames, one per pass of loop() after the
+ * response. GHST 2 (minutes) and GHST 3 (hours) send the closed buckets that start at or
+ * after the given time as a single rollup frame, or "GERR 11" on boards built with
+ * SAMPLE_ROLLUP set to 0. Keys are numbered as in the GDSC dictionary and times are
+ * controller time, or seconds since startup if the clock was never set. Returns the number
+ * of records or rows that will be sent, the size of the tier and the bytes of RAM used by
+ * the history and its rollups. Only available when connected.
+ * Example: "GHST 1":{"records":48,"capacity":64,"memory":524},
+ * Example: "GHST 3":{"rows":6,"keys":10,"capacity":6,"memory":1721},
+ */
+String handleHistoryInstruction(Instruction instruction);
+
+/**
+ * \brief Prints the sample and report periods of a module (numbered from 1), and the
+ * shortest sample period it takes, to out.
+ * Example: "GRAT 3":{"name":"SWTM 1","sample":30000,"report":30000,"minimum":810},
+ */
+void printRateMessage(Print &out, int module_number);
+
+/**
+ * \brief Prints begin(), update(), and set() timing statistics of all modules to out.
+ * Each module is reported under "GPRF <first instruction code> <id>", followed by the
+ * baud rate and receive statistics of the serial link under "GPRF COMM".
+ * Example: "GPRF SLIN 1":{"begin":1032,"update":{"n":12,...},"set":{"n":3,...}},
+ * "GPRF COMM":{"baud":115200,"receive":{"frames":3,"rejected":0,"latency":1432}},
+ */
+void printProfileMessage(Print &out);
+
 /** 
  *  \brief Formats an instruction string into an instruction struct.
  *  Message is broken into 3 parts: Instruction Code, Instruction ID, Instruction Parameter 
@@ -17,24 +17,12 @@ void SensorContactSwitch::begin(void) {
  pinMode(pin_,INPUT_PULLUP);
 }
 
-String SensorContactSwitch::get(void) {
-  // Get Sensor Data
+void SensorContactSwitch::update(void) {
   is_connected_ = getData();
+}
 
-  // Initialize Message
-  String message = "";
-
-  // Append Actuator State
-  message += "\"";
-  message += instruction_code_;
-  message += " ";
-  message += instruction_id_;
-  message += "\":";
-  message += is_connected_;
-  message += ",";
-
-  // return "";
-  return message;
+void SensorContactSwitch::print(MessageWriter &message) {
+  message.add(instruction_code_.c_str(), instruction_id_, (long)is_connected_);
 }
 
 String SensorContactSwitch::set(String instruction_code, int instruction_id, String instruction_parameter) {
@@ -17,12 +17,13 @@
 /** 
  *  \brief Sensor module for all sensors that behave like a contact switch.
  */
-class SensorContactSwitch : SensorActuatorModule {
+class SensorContactSwitch : public SensorActuatorModule {
   public:
     // Public Functions
     SensorContactSwitch(int pin, String instruction_code, int instruction_id);
     void begin(void); 
-    String get(void); 
+    void update(void);
+    void print(MessageWriter &message);
     String set(String instruction_code, int instruction_id, String instruction_parameter);
 
     // Public Variables
@@ -47,42 +47,14 @@ void SensorDfr01610300::begin(void) {
   ec_calibration_offset_ = 0.15;
 }
 
-String SensorDfr01610300::get(void) {
-  // Get PH, Temperature, & EC Data
+void SensorDfr01610300::update(void) {
   getSensorData();
+}
 
-  // Initialize Message
-  String message = "";
-
-  // Append PH
-  message += "\"";
-  message += ph_instruction_code_;
-  message += " ";
-  message += ph_instruction_id_;
-  message += "\":";
-  message += String(ph_filtered,1);
-  message += ",";
-
-  // Append Temperature
-  message += "\"";
-  message += temperature_instruction_code_;
-  message += " ";
-  message += temperature_id_;
-  message += "\":";
-  message += String(temperature_filtered,1);
-  message += ",";
-
-  // Append EC
-  message += "\"";
-  message += ec_instruction_code_;
-  message += " ";
-  message += ec_id_;
-  message += "\":";
-  message += String(ec_filtered,1);
-  message += ",";
-
-  // Return Message
-  return message;
+void SensorDfr01610300::print(MessageWriter &message) {
+  message.add(ph_instruction_code_.c_str(), ph_instruction_id_, ph_filtered, 1);
+  message.add(temperature_instruction_code_.c_str(), temperature_id_, temperature_filtered, 1);
+  message.add(ec_instruction_code_.c_str(), ec_id_, ec_filtered, 1);
 }
 
 String SensorDfr01610300::set(String instruction_code, int instruction_id, String instruction_parameter) {
@@ -123,7 +95,6 @@ float SensorDfr01610300::getPh(void) {
   // Sampling Specifications
   int samples = 40;
   int voltage[samples];
-  const int sample_time_delta = 20; // milliseconds
 
   // Acquire Samples
   for (int i=0; i<samples; i++) {
@@ -140,7 +111,7 @@ float SensorDfr01610300::getPh(void) {
 float SensorDfr01610300::getTemperature(void) {
   float temperature_value;
   // Read Temperature
-  byte present = ds_->reset();
+  ds_->reset();
   ds_->select(temperature_address_);    
   ds_->write(0xBE); // Read Scratchpad            
   for (int i = 0; i < 9; i++) { // we need 9 bytes
@@ -210,7 +181,7 @@ float SensorDfr01610300::avergeArray(int* arr, int number){
   float avg;
   long amount=0;
   if(number<=0){
-    Serial.println("Error number for the array to averaging!/n");
+    Serial.println(F("Error number for the array to averaging!/n"));
     return 0;
   }
   if(number<5){   //less than 5, calculated directly statistics
@@ -38,7 +38,7 @@
 /**
  * \brief Sensor module for water ph, ec, and temperature.
  */
-class SensorDfr01610300 : SensorActuatorModule {
+class SensorDfr01610300 : public SensorActuatorModule {
   public:
     // Public Functions
     /*
@@ -54,12 +54,17 @@ class SensorDfr01610300 : SensorActuatorModule {
     void begin(void);
     
     /**
-     * \brief Returns JSON string with module data.
+     * \brief Reads the sensor. Called by the scheduler.
+     */
+    void update(void);
+
+    /**
+     * \brief Appends JSON key value pairs with the latest module data to message.
      * Module data: ph, temperature, ec.
      * Data: "<instruction_code> <instruction_id> <value>".
      * Example: "SWPH 1 1", "SWTM 1 1", "SWEC 1 1", 
      */
-    String get(void);
+    void print(MessageWriter &message);
 
     /**
      * \brief Reserved to passing data string to object
@@ -101,9 +106,9 @@ class SensorDfr01610300 : SensorActuatorModule {
     float ph_calibration_offset_;
     float ec_calibration_coefficient_;
     float ec_calibration_offset_;
-    int ec_on_delay_;
-    int ec_off_delay_;
-    int prev_update_time_;
+    uint32_t ec_on_delay_; // milliseconds
+    uint32_t ec_off_delay_; // milliseconds
+    uint32_t prev_update_time_;
     bool last_update_was_ec_;
     byte temperature_data_[12];
     byte temperature_address_[8];
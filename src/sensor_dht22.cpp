@@ -5,164 +5,339 @@
  */
 #include "sensor_dht22.h"
 
-SensorDht22::SensorDht22(int pin, String temperature_instruction_code, int temperature_instruction_id, String humidity_instruction_code, int humidity_instruction_id){
-  pin_ = pin;
-  humidity_instruction_code_ = humidity_instruction_code;
-  humidity_instruction_id_ = humidity_instruction_id;
-  temperature_instruction_code_ = temperature_instruction_code;
-  temperature_instruction_id_ = temperature_instruction_id;
-  
-  count_ = COUNT;
-  first_reading_ = true;
+SensorDht22::SensorDht22(int pin, String temperature_instruction_code, int temperature_instruction_id, String humidity_instruction_code, int humidity_instruction_id) : capture_(pin) {
+  uint8_t pin8 = pin;
+  initialize(&pin8, 1, temperature_instruction_code, humidity_instruction_code);
+  sensors_[0].temperature_id = temperature_instruction_id;
+  sensors_[0].humidity_id = humidity_instruction_id;
+}
+
+SensorDht22::SensorDht22(const uint8_t *pins, const uint8_t *ids, uint8_t sensor_count, String temperature_instruction_code,
+                         String humidity_instruction_code) : capture_(pins, sensor_count) {
+  initialize(pins, sensor_count, temperature_instruction_code, humidity_instruction_code);
+  for (uint8_t i = 0; i < sensor_count_; i++) {
+    sensors_[i].temperature_id = ids[i];
+    sensors_[i].humidity_id = ids[i];
+  }
 }
 
 void SensorDht22::begin(void) {
-  pinMode(pin_, INPUT);
-  digitalWrite(pin_, HIGH);
+  // Release Every Line To The Pull-Up
+  for (uint8_t i = 0; i < sensor_count_; i++) {
+    DIRECT_MODE_INPUT(base_reg_, capture_.getBitmask(i));
+    DIRECT_WRITE_HIGH(base_reg_, capture_.getBitmask(i));
+  }
   last_read_time_ = 0;
 }
 
-String SensorDht22::get(void) {
-  // Get Sensor Data
+void SensorDht22::update(void) {
+  // Read At Most Every 2 Seconds Less The Jitter Of The Scheduler, Keep The Last Reading Meanwhile
+  uint32_t current_time = millis();
+  if (!first_reading_ && ((current_time - last_read_time_) < kMinReadPeriod - kReadSlack)) {
+    new_reading_ = false;
+    return;
+  }
+  first_reading_ = false;
+  last_read_time_ = current_time;
+  new_reading_ = false;
+  pending_ = (1 << sensor_count_) - 1;
+  attempt_ = 0;
+
+  // Read In The Background If The Pins Have External Interrupts
+  if (capture_.isAvailable()) {
+    startTransfer();
+    step_ = kStartStep;
+    return;
+  }
   getSensorData();
+}
 
-  // Initialize Message
-  String message = "";
+bool SensorDht22::finishUpdate(void) {
+  // Release The Lines After The Start Pulse, Then Record The Changes The Sensors Make
+  if (step_ == kStartStep) {
+    if (millis() - step_start_ < kStartTime) {
+      return false;
+    }
+    releaseLines();
+    capture_.start();
+    step_start_ = millis();
+    step_ = kCaptureStep;
+    return false;
+  }
 
-  // Append Temperature
-  message += "\"";
-  message += temperature_instruction_code_;
-  message += " ";
-  message += temperature_instruction_id_;
-  message += "\":";
-  message += String(temperature,1);
-  message += ",";
+  // Decode Once The Lines Are Quiet, Retry The Sensors That Failed
+  if (step_ == kCaptureStep) {
+    uint16_t changes = capture_.getChanges();
+    bool quiet = changes && ((uint16_t)((uint16_t)micros() - capture_.getTime(changes - 1)) > kQuietTime);
+    if (!quiet && (millis() - step_start_ < kTransferTime)) {
+      return false;
+    }
+    capture_.stop();
+    step_ = kIdleStep;
+    if (finishTransfer()) {
+      startTransfer();
+      step_ = kStartStep;
+      return false;
+    }
+  }
+  return true;
+}
 
-  // Append Humidity
-  message += "\"";
-  message += humidity_instruction_code_;
-  message += " ";
-  message +=  humidity_instruction_id_;
-  message += "\":";
-  message += String(humidity,1);
-  message += ",";
+bool SensorDht22::hasNewReading(void) {
+  return new_reading_;
+}
 
-  // Return Message
-  return message;
+bool SensorDht22::needsInterrupts(void) {
+  return step_ == kCaptureStep;
+}
+
+void SensorDht22::print(MessageWriter &message) {
+  // Report Errors, Once For All Sensors
+  bool checksum_error = false;
+  bool timeout = false;
+  for (uint8_t i = 0; i < sensor_count_; i++) {
+    checksum_error |= (sensors_[i].error == kChecksumError);
+    timeout |= (sensors_[i].error == kTimeout);
+  }
+  if (checksum_error) {
+    message.addText("GERR", 14, F("dht22 checksum error"));
+  }
+  if (timeout) {
+    message.addText("GERR", 15, F("dht22 timeout"));
+  }
+
+  // Append Temperature & Humidity Of Each Sensor Read At Least Once
+  for (uint8_t i = 0; i < sensor_count_; i++) {
+    if (!sensors_[i].valid) {
+      continue;
+    }
+    message.add(temperature_instruction_code_.c_str(), sensors_[i].temperature_id, sensors_[i].temperature, 1);
+    message.add(humidity_instruction_code_.c_str(), sensors_[i].humidity_id, sensors_[i].humidity, 1);
+  }
+}
+
+uint32_t SensorDht22::getMinimumPeriod(void) {
+  return kMinReadPeriod;
 }
 
 String SensorDht22::set(String instruction_code, int instruction_id, String parameter) {
   return "";
 }
 
-void SensorDht22::getRawSensorData(void) {
-  humidity_raw_ = 0;
-  temperature_raw_ = 0;
-  if (read()) {
-    humidity_raw_ = data[0];
-    humidity_raw_ *= 256;
-    humidity_raw_ += data[1];
-    humidity_raw_ /= 10;
-    
-    temperature_raw_ = data[2] & 0x7F;
-    temperature_raw_ *= 256;
-    temperature_raw_ += data[3];
-    temperature_raw_ /= 10;
-    if (data[2] & 0x80) {
-      temperature_raw_ *= -1;
-    }    
+//------------------------------------------PRIVATE FUNCTIONS----------------------------------------//
+void SensorDht22::initialize(const uint8_t *pins, uint8_t sensor_count, String temperature_instruction_code,
+                             String humidity_instruction_code) {
+  temperature_instruction_code_ = temperature_instruction_code;
+  humidity_instruction_code_ = humidity_instruction_code;
+  sensor_count_ = (sensor_count > kMaxSensors) ? kMaxSensors : sensor_count;
+  base_reg_ = PIN_TO_BASEREG(pins[0]);
+  for (uint8_t i = 0; i < kMaxSensors; i++) {
+    sensors_[i].temperature_id = 0;
+    sensors_[i].humidity_id = 0;
+    sensors_[i].valid = false;
+    sensors_[i].error = kNoError;
+    sensors_[i].humidity = 0;
+    sensors_[i].temperature = 0;
+    timings[i].preamble_low = 0;
+    timings[i].preamble_high = 0;
+    timings[i].bit_low = 0;
+    timings[i].zero_high = 0;
+    timings[i].one_high = 0;
   }
+  first_reading_ = true;
+  step_ = kIdleStep;
+  pending_ = 0;
+  attempt_ = 0;
+  new_reading_ = false;
+  checksum_errors = 0;
+  timeouts = 0;
+  retries = 0;
 }
 
 void SensorDht22::getSensorData(void) {
-  getRawSensorData();
-  filterSensorData();
+  // Record Every Sensor At Once In A Timed Loop, Retry The Sensors That Failed
+  do {
+    startTransfer();
+    delay(kStartTime);
+    releaseLines();
+    capture_.sample(PulseCapture::kMaxChanges, kQuietPasses);
+  } while (finishTransfer());
 }
 
-void SensorDht22::filterSensorData(void) {
-  humidity = humidity_raw_;
-  temperature = temperature_raw_;
+void SensorDht22::startTransfer(void) {
+  // Pull The Lines Low Together To Wake The Sensors
+  IO_REG_TYPE mask = 0;
+  for (uint8_t i = 0; i < sensor_count_; i++) {
+    if (pending_ & (1 << i)) {
+      mask |= capture_.getBitmask(i);
+    }
+  }
+  DIRECT_WRITE_LOW(base_reg_, mask);
+  DIRECT_MODE_OUTPUT(base_reg_, mask);
+  step_start_ = millis();
 }
 
-boolean SensorDht22::read(void) {
-  uint8_t last_state = HIGH;
-  uint8_t counter = 0;
-  uint8_t j = 0, i;
-  unsigned long current_time;
-
-  digitalWrite(pin_, HIGH);
-  delay(2); // old delay time was 250
+void SensorDht22::releaseLines(void) {
+  // Release The Lines Together To The Pull-Up
+  IO_REG_TYPE mask = 0;
+  for (uint8_t i = 0; i < sensor_count_; i++) {
+    if (pending_ & (1 << i)) {
+      mask |= capture_.getBitmask(i);
+    }
+  }
+  DIRECT_WRITE_HIGH(base_reg_, mask);
+  DIRECT_MODE_INPUT(base_reg_, mask);
+}
 
-  current_time = millis();
-  if (current_time < last_read_time_) {
-    // ie there was a rollover
-    last_read_time_ = 0;
+bool SensorDht22::finishTransfer(void) {
+  // Decode Each Sensor Read, Keep Those That Failed For A Retry
+  uint8_t failed = 0;
+  uint8_t failed_count = 0;
+  for (uint8_t i = 0; i < sensor_count_; i++) {
+    if (!(pending_ & (1 << i))) {
+      continue;
+    }
+    if (decode(i)) {
+      getRawSensorData(i);
+      filterSensorData(i);
+      sensors_[i].valid = true;
+      new_reading_ = true;
+    }
+    else {
+      failed |= 1 << i;
+      failed_count++;
+    }
   }
-  if (!first_reading_ && ((current_time - last_read_time_) < 2000)) {
-    return true; // return last correct measurement
-    // delay(2000 - (currenttime - _lastreadtime));
+  pending_ = failed;
+  if (!pending_ || (attempt_ >= kReadRetries)) {
+    return false;
   }
-  first_reading_ = false;
-  last_read_time_ = millis();
+  attempt_++;
+  retries += failed_count;
+  return true;
+}
 
-  data[0] = data[1] = data[2] = data[3] = data[4] = 0;
+void SensorDht22::getRawSensorData(uint8_t sensor) {
+  Sensor &s = sensors_[sensor];
+  s.humidity_raw = data[0];
+  s.humidity_raw *= 256;
+  s.humidity_raw += data[1];
+  s.humidity_raw /= 10;
   
-  // now pull it low for ~20 milliseconds
-  pinMode(pin_, OUTPUT);
-  digitalWrite(pin_, LOW);
-  delay(20);
-  //cli();
-  digitalWrite(pin_, HIGH);
-  delayMicroseconds(40);
-  pinMode(pin_, INPUT);
-
-  // read in timings
-  for ( i=0; i< MAXTIMINGS; i++) {
-    counter = 0;
-    while (digitalRead(pin_) == last_state) {
-      counter++;
-      delayMicroseconds(1);
-      if (counter == 255) {
-        break;
-      }
+  s.temperature_raw = data[2] & 0x7F;
+  s.temperature_raw *= 256;
+  s.temperature_raw += data[3];
+  s.temperature_raw /= 10;
+  if (data[2] & 0x80) {
+    s.temperature_raw *= -1;
+  }    
+}
+
+void SensorDht22::filterSensorData(uint8_t sensor) {
+  sensors_[sensor].humidity = sensors_[sensor].humidity_raw;
+  sensors_[sensor].temperature = sensors_[sensor].temperature_raw;
+}
+
+bool SensorDht22::decode(uint8_t sensor) {
+  // Measure The Pulses Of The Pin Of The Sensor From The Capture, Starting With A Low One
+  PulseReader reader;
+  reader.bitmask = capture_.getBitmask(sensor);
+  reader.change = 0;
+  reader.high = capture_.getPort(PulseCapture::kStart) & reader.bitmask;
+  reader.since = capture_.getTime(PulseCapture::kStart);
+  uint8_t preamble_low;
+  uint8_t preamble_high;
+  if ((reader.high && !readPulse(reader, preamble_low)) ||
+      !readPulse(reader, preamble_low) || !readPulse(reader, preamble_high)) {
+    return checkData(sensor, 0);
+  }
+
+  // Find The Preamble, A Low & High Longer Than The Low Of The First Bit (80 & 50 us)
+  PulseReader bits = reader;
+  uint8_t low;
+  uint8_t high;
+  while (readPulse(reader, low) && readPulse(reader, high)) {
+    if ((preamble_low * 4 >= low * 5) && (preamble_high * 4 >= low * 5)) {
+      return decodeBits(sensor, preamble_low, preamble_high, bits);
     }
-    last_state = digitalRead(pin_);
+    preamble_low = low;
+    preamble_high = high;
+    bits = reader;
+  }
+  return checkData(sensor, 0);
+}
 
-    if (counter == 255) break;
+bool SensorDht22::decodeBits(uint8_t sensor, uint8_t preamble_low, uint8_t preamble_high, const PulseReader &bits) {
+  // Set The Threshold To The Average Low Of The Bits, 50 us Between A 0 (26 us) & A 1 (70 us) High
+  data[0] = data[1] = data[2] = data[3] = data[4] = 0;
+  PulseReader reader = bits;
+  uint16_t low_sum = 0;
+  uint8_t low;
+  uint8_t high;
+  for (uint8_t j = 0; j < 40; j++) {
+    if (!readPulse(reader, low) || !readPulse(reader, high)) {
+      return checkData(sensor, 0);
+    }
+    low_sum += low;
+  }
+  Timing &timing = timings[sensor];
+  timing.bit_low = low_sum / 40;
+  timing.preamble_low = preamble_low;
+  timing.preamble_high = preamble_high;
 
-    // ignore first 3 transitions
-    if ((i >= 4) && (i%2 == 0)) {
-      // shove each bit into the storage bytes
-      data[j/8] <<= 1;
-      if (counter > count_)
-        data[j/8] |= 1;
-      j++;
+  // Read A Bit From The High Of Each Pair Of Pulses, Measured Again
+  reader = bits;
+  uint16_t zero_sum = 0;
+  uint16_t one_sum = 0;
+  uint8_t ones = 0;
+  for (uint8_t j = 0; j < 40; j++) {
+    readPulse(reader, low);
+    readPulse(reader, high);
+    data[j / 8] <<= 1;
+    if (high > timing.bit_low) {
+      data[j / 8] |= 1;
+      one_sum += high;
+      ones++;
+    }
+    else {
+      zero_sum += high;
     }
   }
+  timing.zero_high = (ones < 40) ? zero_sum / (40 - ones) : 0;
+  timing.one_high = ones ? one_sum / ones : 0;
+  return checkData(sensor, 40);
+}
 
-  // check we read 40 bits and that the checksum matches
-  if ((j >= 40) && 
-      (data[4] == ((data[0] + data[1] + data[2] + data[3]) & 0xFF)) ) {
+bool SensorDht22::readPulse(PulseReader &reader, uint8_t &length) {
+  // Measure Up To The Next Change Of The Pin, Capped At 255
+  uint16_t changes = capture_.getChanges();
+  while (reader.change < changes) {
+    uint16_t n = reader.change++;
+    bool high = capture_.getPort(n) & reader.bitmask;
+    if (high == reader.high) {
+      continue; // another pin, or a pulse too short to catch
+    }
+    uint16_t pulse = capture_.getTime(n) - reader.since;
+    length = (pulse > 255) ? 255 : pulse;
+    reader.since = capture_.getTime(n);
+    reader.high = high;
     return true;
   }
   return false;
 }
 
-
-String SensorDht22::floatToString( double val, unsigned int precision) {
-// prints val with number of decimal places determine by precision
-// NOTE: precision is 1 followed by the number of zeros for the desired number of decimial places
-// example: printDouble( 3.1415, 100); // prints 3.14 (two decimal places)
-  String str = "";
-  str += int(val);  //prints the int part
-  str += "."; // print the decimal point
-  unsigned int frac;
-  if(val >= 0) {
-    frac = (val - int(val)) * precision;
+bool SensorDht22::checkData(uint8_t sensor, uint8_t bits) {
+  // Check We Read 40 Bits & The Checksum Matches
+  if (bits < 40) {
+    timeouts++;
+    sensors_[sensor].error = kTimeout;
+    return false;
   }
-  else {
-    frac = (int(val)- val ) * precision;
+  if (data[4] != ((data[0] + data[1] + data[2] + data[3]) & 0xFF)) {
+    checksum_errors++;
+    sensors_[sensor].error = kChecksumError;
+    return false;
   }
-  str += int(frac);
-  return str;
-} 
+  sensors_[sensor].error = kNoError;
+  return true;
+}
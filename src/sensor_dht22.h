@@ -1,6 +1,30 @@
 /** 
  *  \file sensor_dht22.h
  *  \brief Sensor module for air temperature and humidity.
+ *  \details The board wakes the sensor with a low pulse of at least 1 ms, the sensor
+ *  answers with an 80 us low & high preamble, then 40 bits as a 50 us low and a 26 us (0)
+ *  or 70 us (1) high. On a pin with an external interrupt the transfer is read in the
+ *  background: update() pulls the line low, finishUpdate() releases it after kStartTime,
+ *  records the changes of the pin with a PulseCapture and decodes the bits from the
+ *  measured pulse lengths when the transfer is over, so the loop keeps running meanwhile
+ *  and interrupts cannot skew the bits. On other pins update() records the transfer in a
+ *  loop that reads the port once a pass, blocking for about 7 ms. Either way a high is a
+ *  1 if it is longer than the average 50 us low of the bits in the same transfer, so the
+ *  threshold follows the clock, compiler and loop body without tuning. The pulses are
+ *  measured from the capture where they are needed, without a copy. The timings of the
+ *  last transfer read to the end are kept in timings for diagnostics. A read that fails
+ *  the checksum or times out is retried up to kReadRetries times, then reported with
+ *  "GERR 14" or "GERR 15" while the last good reading is kept, with the time it was read
+ *  (see hasNewReading()). A sensor never read is left out of the messages. The sensor is
+ *  read at most every 2 s, less kReadSlack so a read the scheduler starts a little early
+ *  is not skipped.
+ *
+ *  Up to kMaxSensors sensors on pins of the same port are read at once, e.g. one per
+ *  canopy height: their lines are pulled low and released with one register write, the
+ *  changes of all of them go into one capture (or one pass of the loop), and the bits of
+ *  each sensor are taken from the changes of its pin, so reading N sensors costs about
+ *  the time of one. Only the sensors that failed are retried. Pins on another port than
+ *  the first are left out.
  */
 
 // Library based off: DHT library from Seeed Studio
@@ -17,56 +41,137 @@
 #endif
 
 #include "module_handler.h"
-
-// 8 MHz(ish) AVR ---------------------------------------------------------
-#if (F_CPU >= 7400000UL) && (F_CPU <= 9500000UL)
-#define COUNT 3
-// 16 MHz(ish) AVR --------------------------------------------------------
-#elif (F_CPU >= 15400000UL) && (F_CPU <= 19000000L)
-#define COUNT 6
-#else
-#error "CPU SPEED NOT SUPPORTED"
-#endif
-
-// how many timing transitions we need to keep track of. 2 * number bits + extra
-#define MAXTIMINGS 85
+#include "support_one_wire.h"
+#include "support_pulse_capture.h"
 
 /** 
  *  \brief Sensor module for air temperature and humidity.
  */
-class SensorDht22 : SensorActuatorModule {
+class SensorDht22 : public SensorActuatorModule {
   public:
     // Public Functions
     SensorDht22(int pin, String temperature_instruction_code, int temperature_instruction_id, String humidity_instruction_code, int humidity_instruction_id);
+
+    /**
+     * \brief Class constructor for a sensor on each of sensor_count pins of the same port,
+     * sensor n reporting temperature & humidity with instruction id ids[n].
+     */
+    SensorDht22(const uint8_t *pins, const uint8_t *ids, uint8_t sensor_count, String temperature_instruction_code,
+                String humidity_instruction_code);
+
     void begin(void);
-    String get(void);
+
+    /**
+     * \brief Starts a read in the background, or reads right away on pins without an
+     * external interrupt. Called by the scheduler.
+     */
+    void update(void);
+
+    /**
+     * \brief Releases the start pulse, then decodes the transfer once it is over.
+     * Returns true when done.
+     */
+    bool finishUpdate(void);
+
+    /**
+     * \brief Returns true if a sensor was read in the last update(), false if every read
+     * failed or the sensor was read less than 2 s before.
+     */
+    bool hasNewReading(void);
+
+    /**
+     * \brief Returns true while the transfer is captured on the external interrupts.
+     */
+    bool needsInterrupts(void);
+
+    /**
+     * \brief Appends JSON key value pairs with the latest module data to message.
+     * Module data: temperature & humidity of each sensor read at least once.
+     * Reports "GERR 14":"dht22 checksum error" or "GERR 15":"dht22 timeout" when the
+     * last read of a sensor failed.
+     */
+    void print(MessageWriter &message);
+
+    /**
+     * \brief Returns the 2 s the sensor needs between reads.
+     */
+    uint32_t getMinimumPeriod(void);
+
     String set(String instruction_code, int instruction_id, String parameter);
 
+    // Public Constants
+    static const uint8_t kMaxSensors = PulseCapture::kMaxPins;
+
     // Public Variables
-    float humidity;
-    float temperature;
-    
+    struct Timing { // microseconds, passes of the loop on pins without an external interrupt
+      uint8_t preamble_low;
+      uint8_t preamble_high;
+      uint8_t bit_low; // average, the bit threshold
+      uint8_t zero_high; // average
+      uint8_t one_high; // average
+    };
+    Timing timings[kMaxSensors]; // of the last transfer of each sensor read to the end
+    uint32_t checksum_errors; // reads that failed the checksum
+    uint32_t timeouts; // reads that ended before 40 bits
+    uint32_t retries; // reads repeated
+
   private:
     // Private Functions
+    void initialize(const uint8_t *pins, uint8_t sensor_count, String temperature_instruction_code,
+                    String humidity_instruction_code);
     void getSensorData(void);
-    boolean read(void);
-    void getRawSensorData(void);
-    void filterSensorData(void);
-    String floatToString( double val, unsigned int precision);
-    
+    void startTransfer(void);
+    void releaseLines(void);
+    bool finishTransfer(void);
+    struct PulseReader; // declared below
+    bool decode(uint8_t sensor);
+    bool decodeBits(uint8_t sensor, uint8_t preamble_low, uint8_t preamble_high, const PulseReader &bits);
+    bool readPulse(PulseReader &reader, uint8_t &length);
+    bool checkData(uint8_t sensor, uint8_t bits);
+    void getRawSensorData(uint8_t sensor);
+    void filterSensorData(uint8_t sensor);
+
     // Private Variables
-    int pin_;
+    enum ReadError {kNoError, kChecksumError, kTimeout};
+    enum Step {kIdleStep, kStartStep, kCaptureStep};
+    struct PulseReader { // measures the pulses of the pin of a sensor from the capture, in place
+      uint8_t bitmask;
+      uint16_t change; // next change to look at
+      bool high; // level of the pulse being measured
+      uint16_t since; // time it started, microseconds or passes
+    };
+    struct Sensor {
+      int temperature_id;
+      int humidity_id;
+      bool valid; // has a reading
+      ReadError error;
+      float humidity_raw;
+      float temperature_raw;
+      float humidity;
+      float temperature;
+    };
+    static const uint32_t kMinReadPeriod = 2000; // milliseconds
+    static const uint32_t kReadSlack = 100; // milliseconds, a read scheduled every kMinReadPeriod may start this much early
+    static const uint8_t kStartTime = 2; // milliseconds, the line is low for 1 to 2 ms
+    static const uint8_t kTransferTime = 10; // milliseconds, a transfer takes about 5 ms
+    static const uint16_t kQuietTime = 200; // microseconds without a change end a transfer
+    static const uint16_t kQuietPasses = 200; // passes of the loop without a change end a transfer
+    static const uint8_t kReadRetries = 2;
     String humidity_instruction_code_;
-    int humidity_instruction_id_;
     String temperature_instruction_code_;
-    int temperature_instruction_id_;
+    Sensor sensors_[kMaxSensors];
+    uint8_t sensor_count_;
 
+    PulseCapture capture_;
+    volatile IO_REG_TYPE *base_reg_;
+    Step step_;
+    uint32_t step_start_; // millis()
+    uint8_t pending_; // bit of each sensor still to read
+    uint8_t attempt_;
+    bool new_reading_; // a sensor was read by the last update()
     uint8_t data[6];
-    uint8_t count_;
     uint32_t last_read_time_;
     boolean first_reading_;
-    float humidity_raw_;
-    float temperature_raw_;
 };
 
 #endif // SensorDht22_H_
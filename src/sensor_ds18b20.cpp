@@ -7,82 +7,345 @@
 #include "sensor_ds18b20.h"
 
 //------------------------------------------PUBLIC FUNCTIONS----------------------------------------//
-SensorDs18b20::SensorDs18b20(int temperature_pin, String temperature_instruction_code, int temperature_id) {
-  temperature_pin_ = temperature_pin;
-  temperature_instruction_code_ = temperature_instruction_code;
-  temperature_id_ = temperature_id;
+const uint16_t SensorDs18b20::kConversionTimes[4] = {94, 188, 375, 750};
+
+SensorDs18b20::SensorDs18b20(int temperature_pin, String temperature_instruction_code, int temperature_id, int probe_count) {
+  uint8_t pin = temperature_pin;
+  initialize(&pin, 1, temperature_instruction_code, temperature_id, probe_count);
+}
+
+SensorDs18b20::SensorDs18b20(const uint8_t *temperature_pins, uint8_t pin_count, String temperature_instruction_code,
+                             int temperature_id, int probe_count) {
+  initialize(temperature_pins, pin_count, temperature_instruction_code, temperature_id, probe_count);
 }
 
 void SensorDs18b20::begin(void) {
   // Construct Objects
-  ds_ = new OneWire(temperature_pin_);
-  temperature_filter_ = new MovingAverageFilter(10);
+  for (uint8_t bus = 0; bus < bus_count_; bus++) {
+    ds_[bus] = new OneWire(temperature_pins_[bus]);
+  }
+  bus_ = new OneWireEngine(temperature_pins_, bus_count_);
+  for (uint8_t i = 0; i < probe_count_; i++) {
+    probes_[i].filter = new MovingAverageFilter(10);
+  }
+
+  // Find Probes & Start First Conversion
+  if (findProbes()) {
+    startConversion();
+    while (!finishUpdate()) {
+      delay(1);
+    }
+  }
 }
 
-String SensorDs18b20::get(void) {
-  // Get PH, Temperature, & EC Data
+void SensorDs18b20::update(void) {
   getSensorData();
+}
+
+bool SensorDs18b20::finishUpdate(void) {
+  // Go On With The Sample Each Time A Transaction Is Done
+  while ((step_ != kIdleStep) && !bus_->isBusy()) {
+    if (step_ == kReadStep) {
+      finishReads();
+    }
+    else if (step_ == kConfigureStep) {
+      startConversion();
+    }
+    else { // conversion started
+      conversion_start_ = millis();
+      converting_ = true;
+      step_ = kIdleStep;
+    }
+  }
+  return step_ == kIdleStep;
+}
+
+bool SensorDs18b20::hasNewReading(void) {
+  return new_reading_;
+}
+
+bool SensorDs18b20::needsInterrupts(void) {
+  return step_ != kIdleStep;
+}
 
-  // Initialize Message
-  String message = "";
+bool SensorDs18b20::masksInterrupts(void) {
+  return search_due_;
+}
 
-  // Append Temperature
-  message += "\"";
-  message += temperature_instruction_code_;
-  message += " ";
-  message += temperature_id_;
-  message += "\":";
-  message += String(temperature_filtered,1);
-  message += ",";
+void SensorDs18b20::print(MessageWriter &message) {
+  // Report Errors, Once For All Probes
+  bool not_found = false;
+  bool crc_error = false;
+  for (uint8_t i = 0; i < probe_count_; i++) {
+    not_found |= (probes_[i].error == kNotFound);
+    crc_error |= (probes_[i].error == kCrcError);
+  }
+  if (not_found) {
+    message.addText("GERR", 12, F("ds18b20 not found"));
+  }
+  if (crc_error) {
+    message.addText("GERR", 13, F("ds18b20 crc error"));
+  }
 
-  // Return Message
-  return message;
+  // Append Temperature Of Each Probe
+  for (uint8_t i = 0; i < probe_count_; i++) {
+    if (probes_[i].valid) {
+      message.add(temperature_instruction_code_.c_str(), temperature_id_ + i, probes_[i].temperature_filtered, 1);
+    }
+  }
+}
+
+uint32_t SensorDs18b20::getMinimumPeriod(void) {
+  // Buses Are Read At Once, The One With The Most Probes Sets The Reads
+  uint8_t reads = 0;
+  for (uint8_t bus = 0; bus < bus_count_; bus++) {
+    uint8_t bus_probes = 0;
+    for (uint8_t i = 0; i < probe_count_; i++) {
+      bus_probes += (probes_[i].found && (probes_[i].bus == bus));
+    }
+    reads = (bus_probes > reads) ? bus_probes : reads;
+  }
+  if (reads == 0) { // not searched yet
+    reads = probe_count_;
+  }
+  return kConversionTimes[resolution_ - kMinResolution] + (uint32_t)(reads + 1) * kProbeBusTime;
 }
 
 String SensorDs18b20::set(String instruction_code, int instruction_id, String instruction_parameter) {
+  if ((instruction_code == temperature_instruction_code_) && (instruction_id >= temperature_id_) &&
+      (instruction_id < temperature_id_ + probe_count_)) {
+    int parameter = instruction_parameter.toInt();
+    if (parameter == 0) {
+      search_due_ = true; // search on the read that follows
+    }
+    else if ((parameter >= kMinResolution) && (parameter <= kMaxResolution)) {
+      resolution_ = parameter;
+      configuration_due_ = true; // written before the next conversion
+    }
+  }
   return "";
 }
 
 //------------------------------------------PRIVATE FUNCTIONS----------------------------------------//
+void SensorDs18b20::initialize(const uint8_t *temperature_pins, uint8_t pin_count, String temperature_instruction_code,
+                               int temperature_id, int probe_count) {
+  bus_count_ = (pin_count > OneWireEngine::kMaxBuses) ? OneWireEngine::kMaxBuses : pin_count;
+  for (uint8_t bus = 0; bus < bus_count_; bus++) {
+    temperature_pins_[bus] = temperature_pins[bus];
+  }
+  temperature_instruction_code_ = temperature_instruction_code;
+  temperature_id_ = temperature_id;
+  probe_count_ = (probe_count > kMaxProbes) ? kMaxProbes : probe_count;
+  for (uint8_t i = 0; i < kMaxProbes; i++) {
+    probes_[i].address[0] = 0;
+    probes_[i].bus = 0;
+    probes_[i].found = false;
+    probes_[i].valid = false;
+    probes_[i].error = kNoError;
+    probes_[i].filter = NULL;
+  }
+  probes_found = 0;
+  searches = 0;
+  crc_errors = 0;
+  retries = 0;
+  search_due_ = true;
+  new_reading_ = false;
+  reads_to_search_ = kSearchReads;
+  resolution_ = kMaxResolution; // power on default
+  configuration_due_ = false;
+  converting_ = false;
+  step_ = kIdleStep;
+}
+
 void SensorDs18b20::getSensorData(void) {
-  // Update Temperature
-  temperature_raw = getTemperature();
-  temperature_filtered = (float)round(temperature_filter_->process(temperature_raw)*10)/10; // set accuracy to +-0.05
-}
-
-
-float SensorDs18b20::getTemperature(void) {
-  float temperature_value;
-  // Read Temperature
-  byte present = ds_->reset();
-  ds_->select(temperature_address_);    
-  ds_->write(0xBE); // Read Scratchpad            
-  for (int i = 0; i < 9; i++) { // we need 9 bytes
-    temperature_data_[i] = ds_->read();
-  }         
-  ds_->reset_search();           
-  byte MSB = temperature_data_[1];
-  byte LSB = temperature_data_[0];        
-  float tempRead = ((MSB << 8) | LSB); // using two's compliment
-  temperature_value = tempRead / 16;
-
-  // Start Conversion For Next Temperature Reading
-  if ( !ds_->search(temperature_address_)) {
-     // Serial.println("no more sensors on chain, reset search!");
-      ds_->reset_search();
-  }      
-  if ( OneWire::crc8(temperature_address_, 7) != temperature_address_[7]) {
-     // Serial.println("CRC is not valid!");
-  }        
-  if ( temperature_address_[0] != 0x10 && temperature_address_[0] != 0x28) {
-     // Serial.print("Device is not recognized!");
-  }      
-  ds_->reset();
-  ds_->select(temperature_address_);
-  ds_->write(0x44,1); // start conversion, with parasite power on at the end
-
-  // Return Temperature
-  return temperature_value;
+  // Search Buses On First Read, After A Failed One & Every kSearchReads Reads While Probes Are Missing
+  new_reading_ = false;
+  if (search_due_) {
+    findProbes();
+  }
+  else if ((probes_found < probe_count_) && (--reads_to_search_ == 0)) {
+    search_due_ = true; // on the next read, so masksInterrupts() tells the scheduler beforehand
+  }
+  if (probes_found == 0) {
+    return;
+  }
+
+  // Read Temperatures Once Converted, A Conversion Still Running Is Read On The Next Sample
+  if (converting_) {
+    if (millis() - conversion_start_ < conversion_time_) {
+      return;
+    }
+    for (uint8_t bus = 0; bus < bus_count_; bus++) {
+      read_probes_[bus] = -1;
+      next_probes_[bus] = 0;
+    }
+    startReads();
+  }
+  else {
+    startConversion();
+  }
+}
+
+bool SensorDs18b20::findProbes(void) {
+  // Search Every Bus For DS18B20s With A Valid ROM Code, Known Probes Keep Their Id
+  searches++;
+  probes_found = 0;
+  for (uint8_t i = 0; i < probe_count_; i++) {
+    probes_[i].found = false;
+  }
+  byte new_addresses[kMaxProbes][8];
+  uint8_t new_buses[kMaxProbes];
+  uint8_t new_count = 0;
+  byte address[8];
+  for (uint8_t bus = 0; bus < bus_count_; bus++) {
+    ds_[bus]->reset_search();
+    while (ds_[bus]->search(address)) {
+      if ((OneWire::crc8(address, 7) != address[7]) || (address[0] != kFamilyCode)) {
+        continue;
+      }
+      int probe = -1;
+      for (uint8_t i = 0; (i < probe_count_) && (probe < 0); i++) {
+        if (memcmp(probes_[i].address, address, 8) == 0) {
+          probe = i;
+        }
+      }
+      if (probe >= 0) {
+        probes_[probe].bus = bus;
+        probes_[probe].found = true;
+        probes_found++;
+      }
+      else if (new_count < kMaxProbes) {
+        memcpy(new_addresses[new_count], address, 8);
+        new_buses[new_count++] = bus;
+      }
+    }
+  }
+
+  // Give New Probes A Free Id, Else One Of A Missing Probe
+  for (uint8_t n = 0; n < new_count; n++) {
+    int probe = -1;
+    for (uint8_t i = 0; (i < probe_count_) && (probe < 0); i++) {
+      if (probes_[i].address[0] == 0) {
+        probe = i;
+      }
+    }
+    for (uint8_t i = 0; (i < probe_count_) && (probe < 0); i++) {
+      if (!probes_[i].found) {
+        probe = i;
+        probes_[i].valid = false;
+      }
+    }
+    if (probe < 0) { // more probes than ids
+      break;
+    }
+    memcpy(probes_[probe].address, new_addresses[n], 8);
+    probes_[probe].filter->reset(); // a new probe does not average in the readings of the last
+    probes_[probe].bus = new_buses[n];
+    probes_[probe].found = true;
+    probes_found++;
+    converting_ = false; // new probe, its scratchpad is not converted yet
+  }
+
+  // Report Probes Missing
+  for (uint8_t i = 0; i < probe_count_; i++) {
+    if (!probes_[i].found) {
+      probes_[i].error = kNotFound;
+    }
+  }
+  search_due_ = false;
+  reads_to_search_ = kSearchReads; // ids without a probe are not searched for on every read
+  configuration_due_ |= (probes_found > 0) && (resolution_ != kMaxResolution); // new probes start at 12 bits
+  return probes_found > 0;
+}
+
+void SensorDs18b20::startReads(void) {
+  // Read Scratchpad Of The Next Probe Of Every Bus At Once, Then Start The Next Conversion
+  uint8_t buses = 0;
+  for (uint8_t bus = 0; bus < bus_count_; bus++) {
+    while ((read_probes_[bus] < 0) && (next_probes_[bus] < probe_count_)) {
+      Probe &probe = probes_[next_probes_[bus]];
+      if (probe.found && (probe.bus == bus)) {
+        read_probes_[bus] = next_probes_[bus];
+        read_attempts_[bus] = 0;
+      }
+      next_probes_[bus]++;
+    }
+    if (read_probes_[bus] >= 0) {
+      byte *command = &command_[bus * 10];
+      command[0] = 0x55; // match rom
+      memcpy(&command[1], probes_[read_probes_[bus]].address, 8);
+      command[9] = 0xBE; // read scratchpad
+      buses |= 1 << bus;
+    }
+  }
+  if (buses == 0) {
+    startConversion();
+    return;
+  }
+  step_ = bus_->start(command_, 10, scratchpads_, 9, false, buses) ? kReadStep : kIdleStep;
+}
+
+void SensorDs18b20::finishReads(void) {
+  for (uint8_t bus = 0; bus < bus_count_; bus++) {
+    if (read_probes_[bus] < 0) {
+      continue;
+    }
+
+    // Keep Temperature Of A Scratchpad That Passes The CRC, Else Read It Again
+    Probe &probe = probes_[read_probes_[bus]];
+    byte *scratchpad = &scratchpads_[bus * 9];
+    if (!bus_->isPresent(bus)) {
+      probe.error = kNotFound;
+    }
+    else if (OneWire::crc8(scratchpad, 8) == scratchpad[8]) {
+      probe.error = kNoError;
+      probe.valid = true;
+      new_reading_ = true;
+      probe.temperature_raw = (float)(int16_t)((scratchpad[1] << 8) | scratchpad[0]) / 16; // two's complement
+      probe.temperature_filtered = (float)round(probe.filter->process(probe.temperature_raw)*10)/10; // set accuracy to +-0.05
+      read_probes_[bus] = -1;
+      continue;
+    }
+    else {
+      crc_errors++;
+      if (read_attempts_[bus] < kReadRetries) {
+        read_attempts_[bus]++;
+        retries++;
+        continue;
+      }
+      probe.error = kCrcError;
+    }
+    probe.found = false;
+    search_due_ = true; // search again on the next read
+    read_probes_[bus] = -1;
+  }
+  startReads();
+}
+
+void SensorDs18b20::startConversion(void) {
+  // Write Alarm Defaults & Resolution To Every Probe First If Due
+  uint8_t buses = (1 << bus_count_) - 1;
+  if (configuration_due_) {
+    for (uint8_t bus = 0; bus < bus_count_; bus++) {
+      byte *command = &command_[bus * 5];
+      command[0] = 0xCC; // skip rom
+      command[1] = 0x4E; // write scratchpad
+      command[2] = 0x4B; // th
+      command[3] = 0x46; // tl
+      command[4] = ((resolution_ - kMinResolution) << 5) | 0x1F;
+    }
+    configuration_due_ = false;
+    step_ = bus_->start(command_, 5, NULL, 0, false, buses) ? kConfigureStep : kIdleStep;
+    return;
+  }
+
+  // Start Conversion On Every Probe, With Parasite Power On At The End
+  for (uint8_t bus = 0; bus < bus_count_; bus++) {
+    command_[bus * 2] = 0xCC; // skip rom
+    command_[bus * 2 + 1] = 0x44; // convert t
+  }
+  conversion_time_ = kConversionTimes[resolution_ - kMinResolution];
+  step_ = bus_->start(command_, 2, NULL, 0, true, buses) ? kConvertStep : kIdleStep;
 }
 
 float SensorDs18b20::avergeArray(int* arr, int number){
@@ -91,7 +354,7 @@ float SensorDs18b20::avergeArray(int* arr, int number){
   float avg;
   long amount=0;
   if(number<=0){
-    Serial.println("Error number for the array to averaging!/n");
+    Serial.println(F("Error number for the array to averaging!/n"));
     return 0;
   }
   if(number<5){   //less than 5, calculated directly statistics
@@ -1,6 +1,33 @@
 /** 
  *  \file sensor_ds18b20.h
  *  \brief Sensor module for water temperature. 
+ *  \details Reads up to kMaxProbes DS18B20 probes on up to OneWireEngine::kMaxBuses buses,
+ *  numbered with consecutive instruction ids from the first one.
+ *
+ *  The buses are searched once in begin() and the ROM codes are cached. Probes take ids in
+ *  the order the search finds them, bus by bus, which is set by their ROM codes. A probe
+ *  keeps its id when the buses are searched again and new probes take the free ids. A
+ *  probe found with another ROM code than the one it replaces starts a new average.
+ *
+ *  Every probe converts at once on a single Convert T sent with skip(), then the
+ *  scratchpads are read one by one with select(), so a sample costs one conversion time
+ *  and a scratchpad read per probe. Buses on pins of the same port run in lockstep:
+ *  Convert T goes out on every bus at once and the next probe of each bus is read at once,
+ *  so a sample costs the reads of the bus with the most probes. The module is never
+ *  sampled faster than the conversion time plus the bus time of the reads, and a sample
+ *  taken before the conversion is done leaves it running for the next one. Reads,
+ *  configuration and Convert T run in the background on a OneWireEngine, so the loop keeps
+ *  serving the serial port meanwhile, only the search blocks.
+ *
+ *  The scratchpad CRC is checked and a failed read retried up to kReadRetries times. If a
+ *  probe stops answering or keeps failing the CRC, its last good temperature is kept and
+ *  the buses are searched again on the next read, or right away with "<code> <id> 0".
+ *  While fewer probes than ids are found, e.g. one was unplugged or not wired yet, the
+ *  buses are searched again every kSearchReads reads.
+ *
+ *  "<code> <id> <bits>" sets the resolution of every probe to 9, 10, 11 or 12 bits (0.5 to
+ *  0.0625 C), converting in 94, 188, 375 or 750 ms. It is written again to probes found by
+ *  a later search.
  *  \author Jake Rye
  */
 #ifndef SENSOR_DS18B20_H
@@ -15,17 +42,24 @@
 #include "module_handler.h"
 #include "support_moving_average.h"
 #include "support_one_wire.h"
+#include "support_one_wire_engine.h"
 
 /**
- * \brief Sensor module for water ph, ec, and temperature.
+ * \brief Sensor module for water temperature.
  */
-class SensorDs18b20 : SensorActuatorModule {
+class SensorDs18b20 : public SensorActuatorModule {
   public:
     // Public Functions
     /*
      * \brief Class constructor.
      */
-    SensorDs18b20(int temperature_pin, String temperature_instruction_code, int temperature_id);
+    SensorDs18b20(int temperature_pin, String temperature_instruction_code, int temperature_id, int probe_count = 1);
+
+    /*
+     * \brief Class constructor for a bus on each of pin_count pins of the same port.
+     */
+    SensorDs18b20(const uint8_t *temperature_pins, uint8_t pin_count, String temperature_instruction_code,
+                  int temperature_id, int probe_count);
 
     /**
      * \brief Called once to setup module.
@@ -34,40 +68,117 @@ class SensorDs18b20 : SensorActuatorModule {
     void begin(void);
     
     /**
-     * \brief Returns JSON string with module data.
-     * Module data: temperature
+     * \brief Reads the sensor. Called by the scheduler.
+     */
+    void update(void);
+
+    /**
+     * \brief Reads the scratchpads and starts the next conversion in the background, one
+     * OneWireEngine transaction after the other. Returns true when done.
+     */
+    bool finishUpdate(void);
+
+    /**
+     * \brief Returns true if a conversion finished and the scratchpad of a probe passed
+     * the CRC in the last update(), false if the conversion was still running or every
+     * read failed.
+     */
+    bool hasNewReading(void);
+
+    /**
+     * \brief Returns true while a transaction runs on the timer interrupt.
+     */
+    bool needsInterrupts(void);
+
+    /**
+     * \brief Returns true when the next update() searches the bus, which turns interrupts
+     * off for each slot (see support_one_wire.h).
+     */
+    bool masksInterrupts(void);
+
+    /**
+     * \brief Appends JSON key value pairs with the latest module data to message.
+     * Module data: temperature of each probe read at least once
      * Data: "<instruction_code> <instruction_id> <value>".
+     * Reports "GERR 12":"ds18b20 not found" or "GERR 13":"ds18b20 crc error" when the
+     * last read of a probe failed.
      * Example: "SWTM 1 1", 
      */
-    String get(void);
+    void print(MessageWriter &message);
 
     /**
-     * \brief Reserved to passing data string to object
-     * Currently unused. Exists to comply with SAModule interface.
+     * \brief Returns the conversion time at the resolution set plus the bus time of a sample.
+     */
+    uint32_t getMinimumPeriod(void);
+
+    /**
+     * \brief Searches the bus again for the sensor on "<code> <id> 0", sets the resolution
+     * of every probe on "<code> <id> <9 to 12 bits>".
      */
     String set(String instruction_code, int instruction_id, String instruction_parameter);
 
     // Public Variables
-    float temperature_raw; // degrees C
-    float temperature_filtered; // degrees C
-    
+    uint8_t probes_found; // at the last search
+    uint32_t searches; // bus searches
+    uint32_t crc_errors; // scratchpad reads that failed the CRC
+    uint32_t retries; // scratchpad reads repeated
+
   private:
     // Private Functions
+    void initialize(const uint8_t *temperature_pins, uint8_t pin_count, String temperature_instruction_code,
+                    int temperature_id, int probe_count);
     void getSensorData(void);
-    float getTemperature(void);
+    bool findProbes(void);
+    void startReads(void);
+    void finishReads(void);
+    void startConversion(void);
     float avergeArray(int* arr, int number);
     void startTempertureConversion(void);
     float TempProcess(bool ch);
 
     // Private Variables
-    int temperature_pin_;
+    uint8_t temperature_pins_[OneWireEngine::kMaxBuses];
+    uint8_t bus_count_;
     String temperature_instruction_code_;
     int temperature_id_;
-    int prev_update_time_;
-    byte temperature_data_[12];
-    byte temperature_address_[8];
-    OneWire *ds_;
-    MovingAverageFilter *temperature_filter_;
+    enum ReadError {kNoError, kNotFound, kCrcError};
+    struct Probe {
+      byte address[8]; // ROM code, family code 0 for a free id
+      uint8_t bus;
+      bool found; // answered the last search or read
+      bool valid; // has a reading
+      ReadError error;
+      float temperature_raw; // degrees C
+      float temperature_filtered; // degrees C
+      MovingAverageFilter *filter;
+    };
+    static const uint8_t kMaxProbes = 8;
+    static const uint8_t kReadRetries = 2;
+    static const uint8_t kSearchReads = 10; // reads between searches while probes are missing
+    static const uint8_t kFamilyCode = 0x28;
+    static const uint8_t kMinResolution = 9; // bits
+    static const uint8_t kMaxResolution = 12;
+    static const uint16_t kConversionTimes[4]; // milliseconds, by resolution from 9 bits
+    static const uint8_t kProbeBusTime = 15; // milliseconds to read a scratchpad or start a conversion
+    enum Step {kIdleStep, kReadStep, kConfigureStep, kConvertStep}; // transaction running
+    byte scratchpads_[OneWireEngine::kMaxBuses * 9];
+    byte command_[OneWireEngine::kMaxBuses * 10]; // bytes written by the transaction running, bus after bus
+    Probe probes_[kMaxProbes];
+    uint8_t probe_count_;
+    bool search_due_;
+    bool new_reading_; // a probe was read by the last update()
+    uint8_t reads_to_search_; // reads left until the next search while probes are missing
+    uint8_t resolution_; // bits
+    bool configuration_due_;
+    bool converting_; // every probe found has a conversion running or done
+    uint32_t conversion_start_; // millis()
+    uint16_t conversion_time_; // milliseconds, at the resolution it started with
+    Step step_;
+    int8_t read_probes_[OneWireEngine::kMaxBuses]; // probe of each bus read by the transaction running, -1 for none
+    uint8_t read_attempts_[OneWireEngine::kMaxBuses]; // reads of it that failed the CRC
+    uint8_t next_probes_[OneWireEngine::kMaxBuses]; // probe of each bus to read next, or above
+    OneWire *ds_[OneWireEngine::kMaxBuses]; // search the buses
+    OneWireEngine *bus_; // reads & converts on every bus
 };
 
 #endif // SENSOR_DS18B20_H_
@@ -33,41 +33,18 @@ void SensorGc0011::begin(void) {
   ss_->end();
 }
 
-String SensorGc0011::get(void) {
-  // Get Sensor Data
+void SensorGc0011::update(void) {
   getSensorData();
+}
 
-  // Initialize Message
-  String message = "";
-  
-  // Append CO2 Data to Message
-  message += "\"";
-  message += co2_instruction_code_;
-  message += " ";
-  message += co2_instruction_id_;
-  message += "\":";
-  message += String(co2,0);
-  message += ",";
-
-  // Append Temperature Data to Message
-  message += "\"";
-  message += temperature_instruction_code_;
-  message += " ";
-  message += temperature_instruction_id_;
-  message += "\":";
-  message += String(temperature, 1);
-  message += ",";
+bool SensorGc0011::masksInterrupts(void) {
+  return true;
+}
 
-  // Append Humidity Data to Message
-  message += "\"";
-  message += humidity_instruction_code_;
-  message += " ";
-  message += humidity_instruction_id_;
-  message += "\":";
-  message += String(humidity, 1);
-  message += ",";
-  
-  return message;
+void SensorGc0011::print(MessageWriter &message) {
+  message.add(co2_instruction_code_.c_str(), co2_instruction_id_, co2, 0);
+  message.add(temperature_instruction_code_.c_str(), temperature_instruction_id_, temperature, 1);
+  message.add(humidity_instruction_code_.c_str(), humidity_instruction_id_, humidity, 1);
 }
 
 String SensorGc0011::set(String instruction_code, int instruction_id, String instruction_parameter) {
@@ -24,12 +24,19 @@
 /** 
  *  \brief Sensor module for air co2, temperature, and humidity.
  */
-class SensorGc0011 : SensorActuatorModule {
+class SensorGc0011 : public SensorActuatorModule {
   public:
     // Public Functions
     SensorGc0011(int rx_pin, int tx_pin, String co2_instruction_code, int co2_instruction_id, String temperature_instruction_code, int temperature_instruction_id,String humidity_instruction_code, int humidity_instruction_id);
     void begin(void);
-    String get(void);
+    void update(void);
+    void print(MessageWriter &message);
+
+    /**
+     * \brief Returns true, SoftwareSerial turns interrupts off for every byte of the polls.
+     */
+    bool masksInterrupts(void);
+
     String set(String instruction_code, int instruction_id, String instruction_parameter);
 
     // Public Variables
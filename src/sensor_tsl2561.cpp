@@ -27,39 +27,22 @@ void SensorTsl2561::begin() {
   read_register_timeout_ = 5; // milliseconds
 }
 
-String SensorTsl2561::get(void) {
-  // Get Sensor Data
+void SensorTsl2561::update(void) {
   getSensorData();
-
-    // Initialize Message
-  String message = "";
-
-  // Handle Errors
   if (read_register_error_) {
-    message += "\"GERR 4\":\"tsl2561 read register timeout\",";
     lux_ = 0;
   }
+}
+
+void SensorTsl2561::print(MessageWriter &message) {
+  // Report Errors
+  if (read_register_error_) {
+    message.addText("GERR", 4, F("tsl2561 read register timeout"));
+  }
 
-  // Append Light Intensity
-  message += "\"";
-  message += lux_instruction_code_;
-  message += " ";
-  message += lux_instruction_id_;
-  message += "\":";
-  message += lux_;
-  message += ",";
-
-  // Append Light Par
-  message += "\"";
-  message += par_instruction_code_;
-  message += " ";
-  message += par_instruction_id_;
-  message += "\":";
-  message += floatToString(par_, 100);
-  message += ",";
-
-  // Return Message
-  return message;
+  // Append Light Intensity & Par
+  message.add(lux_instruction_code_.c_str(), lux_instruction_id_, (long)lux_);
+  message.add(par_instruction_code_.c_str(), par_instruction_id_, par_, 2);
 }
 
 
@@ -219,20 +202,3 @@ unsigned long SensorTsl2561::calculateLux(unsigned int iGain, unsigned int tInt,
   return (lux);
 }
 
-String SensorTsl2561::floatToString( double val, unsigned int precision) {
-// prints val with number of decimal places determine by precision
-// NOTE: precision is 1 followed by the number of zeros for the desired number of decimial places
-// example: printDouble( 3.1415, 100); // prints 3.14 (two decimal places)
-  String str = "";
-  str += int(val);  //prints the int part
-  str += "."; // print the decimal point
-  unsigned int frac;
-  if(val >= 0) {
-    frac = (val - int(val)) * precision;
-  }
-  else {
-    frac = (int(val)- val ) * precision;
-  }
-  str += int(frac);
-  return str;
-} 
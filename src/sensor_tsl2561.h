@@ -85,12 +85,13 @@
 /** 
  *  \brief Sensor module for light intensity and par.
  */
-class SensorTsl2561 : SensorActuatorModule {
+class SensorTsl2561 : public SensorActuatorModule {
   public:
     // Public Functions
     SensorTsl2561(String lux_instruction_code, int lux_instruction_id, String par_instruction_code, int par_instruction_id);
     void begin(void);
-    String get(void);
+    void update(void);
+    void print(MessageWriter &message);
     String set(String instruction_code, int instruction_id, String instruction_parameter);
 
     // Public Variables
@@ -105,7 +106,6 @@ class SensorTsl2561 : SensorActuatorModule {
     unsigned long calculateLux(unsigned int iGain, unsigned int tInt,int iType);
     uint8_t readRegister(int deviceAddress, int address);
     void writeRegister(int deviceAddress, int address, uint8_t val);
-    String floatToString( double val, unsigned int precision);
     
     // Private Variables
     String lux_instruction_code_;
@@ -15,24 +15,12 @@ void SensorVernierEc::begin(void) {
   
 }
 
-String SensorVernierEc::get(void) {
-  // Get Sensor Data
+void SensorVernierEc::update(void) {
   ec = getEc();
+}
 
-  // Initialize Message
-  String message = "";
-
-  // Append ec
-  message += "\"";
-  message += ec_instruction_code_;
-  message += " ";
-  message += ec_instruction_id_;
-  message += "\":";
-  message += String(ec,ec_decimal_points_);
-  message += ",";
-
-  // Return
-  return message;
+void SensorVernierEc::print(MessageWriter &message) {
+  message.add(ec_instruction_code_.c_str(), ec_instruction_id_, ec, ec_decimal_points_);
 }
 
 String SensorVernierEc::set(String instruction_code, int instruction_id, String instruction_parameter) {
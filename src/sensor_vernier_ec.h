@@ -18,7 +18,7 @@
 /**
  * \brief Sensor module for ph
  */
-class SensorVernierEc : SensorActuatorModule {
+class SensorVernierEc : public SensorActuatorModule {
   public:
     // Public Functions
     /*
@@ -33,12 +33,17 @@ class SensorVernierEc : SensorActuatorModule {
     void begin(void);
     
     /**
-     * \brief Returns JSON string with module data.
+     * \brief Reads the sensor. Called by the scheduler.
+     */
+    void update(void);
+
+    /**
+     * \brief Appends JSON key value pairs with the latest module data to message.
      * Module data: ec.
      * Data: "<instruction_code> <instruction_id> <value>".
      * Example: "SWEC 1 1", 
      */
-    String get(void);
+    void print(MessageWriter &message);
 
     /**
      * \brief Reserved to passing data string to object
@@ -16,24 +16,12 @@ void SensorVernierPh::begin(void) {
   
 }
 
-String SensorVernierPh::get(void) {
-  // Get Sensor Data
+void SensorVernierPh::update(void) {
   ph = getPh();
+}
 
-  // Initialize Message
-  String message = "";
-
-  // Append Ph
-  message += "\"";
-  message += ph_instruction_code_;
-  message += " ";
-  message += ph_instruction_id_;
-  message += "\":";
-  message += String(ph,ph_decimal_points_);
-  message += ",";
-
-  // Return
-  return message;
+void SensorVernierPh::print(MessageWriter &message) {
+  message.add(ph_instruction_code_.c_str(), ph_instruction_id_, ph, ph_decimal_points_);
 }
 
 String SensorVernierPh::set(String instruction_code, int instruction_id, String instruction_parameter) {
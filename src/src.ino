@@ -10,8 +10,8 @@ void setup() { // runs once
   initializeModules();
 }
 
-void loop() { // runs FOREVER!
+void loop() { // runs FOREVER! never blocks, see updateModules()
   updateIncomingMessage();
+  updateModules();
   updateStreamMessage();
-  delay(2000);
 }
@@ -0,0 +1,71 @@
+/**
+ *  \file support_clock.cpp
+ *  \brief Support module that keeps controller time with millisecond resolution.
+ *  \details See support_clock.h for details.
+ *  \author Jake Rye
+ */
+#include "support_clock.h"
+
+//--------------------------------------------------PUBLIC-------------------------------------------//
+SyncedClock::SyncedClock(void) {
+  syncs = 0;
+  offset = 0;
+  drift = 0;
+  sync_millis_ = 0;
+  sync_seconds_ = 0;
+  sync_milliseconds_ = 0;
+}
+
+void SyncedClock::sync(uint32_t seconds, uint16_t milliseconds, uint32_t board_millis) {
+  // Measure Offset Of The Drift Corrected Clock
+  if (syncs > 0) {
+    uint32_t clock_seconds;
+    uint16_t clock_milliseconds;
+    getTime(board_millis, clock_seconds, clock_milliseconds);
+    int64_t difference = ((int64_t)clock_seconds - seconds) * 1000 + clock_milliseconds - milliseconds;
+    if (difference > 0x7FFFFFFF) {
+      difference = 0x7FFFFFFF;
+    }
+    else if (difference < -0x7FFFFFFF) {
+      difference = -0x7FFFFFFF;
+    }
+    offset = difference;
+
+    // Learn The Drift Left Uncorrected
+    int32_t elapsed = board_millis - sync_millis_;
+    if ((elapsed >= (int32_t)kMinDriftInterval) && ((offset > 1) || (offset < -1))) {
+      float residual = (float)offset * 1000000 / elapsed;
+      if (fabs(drift + residual) <= kMaxDrift) {
+        drift += residual;
+      }
+    }
+  }
+
+  // Set Clock
+  sync_millis_ = board_millis;
+  sync_seconds_ = seconds + milliseconds / 1000;
+  sync_milliseconds_ = milliseconds % 1000;
+  syncs++;
+}
+
+bool SyncedClock::isSet(void) {
+  return syncs > 0;
+}
+
+void SyncedClock::getTime(uint32_t board_millis, uint32_t &seconds, uint16_t &milliseconds) {
+  int32_t elapsed = board_millis - sync_millis_;
+  int32_t corrected = elapsed - (int32_t)(elapsed * drift / 1000000);
+  int32_t total = sync_milliseconds_ + corrected;
+  int32_t whole = total / 1000;
+  int32_t fraction = total % 1000;
+  if (fraction < 0) { // before the sync
+    fraction += 1000;
+    whole--;
+  }
+  seconds = sync_seconds_ + whole;
+  milliseconds = fraction;
+}
+
+uint32_t SyncedClock::getAge(uint32_t board_millis) {
+  return (board_millis - sync_millis_) / 1000;
+}
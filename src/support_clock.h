@@ -0,0 +1,66 @@
+/**
+ *  \file support_clock.h
+ *  \brief Support module that keeps controller time with millisecond resolution.
+ *  \details The controller sets the clock with sync(). Between syncs, times are counted
+ *  from millis() and corrected for the drift of the board's crystal. Each sync adjusts the
+ *  drift by the offset it finds over the time since the last sync, in parts per million.
+ *  Syncs less than kMinDriftInterval apart, offsets within the 1 ms resolution and offsets
+ *  larger than kMaxDrift explains (a step of the controller clock) only set the time.
+ *  Times are valid for 24 days after a sync, syncs are expected every few minutes.
+ *  Uses 22 bytes of RAM.
+ *  \author Jake Rye
+ */
+#ifndef SUPPORT_CLOCK_H
+#define SUPPORT_CLOCK_H
+
+#if ARDUINO >= 100
+ #include "Arduino.h"
+#else
+ #include "WProgram.h"
+#endif
+
+/**
+ * \brief Support module that keeps controller time with millisecond resolution.
+ */
+class SyncedClock {
+  public:
+    // Public Functions
+    SyncedClock(void);
+
+    /**
+     * \brief Sets the clock to controller time seconds.milliseconds (unix time) at
+     * board_millis, and updates offset and drift.
+     */
+    void sync(uint32_t seconds, uint16_t milliseconds, uint32_t board_millis);
+
+    /**
+     * \brief Returns true once the clock has been synced.
+     */
+    bool isSet(void);
+
+    /**
+     * \brief Returns the controller time at board_millis, a millis() reading within 24 days
+     * of the last sync, as seconds.milliseconds.
+     */
+    void getTime(uint32_t board_millis, uint32_t &seconds, uint16_t &milliseconds);
+
+    /**
+     * \brief Returns the number of seconds since the last sync at board_millis.
+     */
+    uint32_t getAge(uint32_t board_millis);
+
+    // Public Variables
+    uint32_t syncs;
+    int32_t offset; // milliseconds the clock was ahead of the controller at the last sync
+    float drift; // parts per million the board's millis() runs fast
+
+  private:
+    // Private Variables
+    static const uint32_t kMinDriftInterval = 60000; // milliseconds
+    static const uint16_t kMaxDrift = 5000; // parts per million, a ceramic resonator is within 0.5%
+    uint32_t sync_millis_; // millis() at the last sync
+    uint32_t sync_seconds_; // controller time at the last sync
+    uint16_t sync_milliseconds_;
+};
+
+#endif // SUPPORT_CLOCK_H_
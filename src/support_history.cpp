@@ -0,0 +1,292 @@
+/**
+ *  \file support_history.cpp
+ *  \brief Support module that keeps the latest readings in RAM for the controller to download.
+ *  \details See support_history.h for details.
+ *  \author Jake Rye
+ */
+#include "support_history.h"
+
+//--------------------------------------------------PUBLIC-------------------------------------------//
+SampleRollup::SampleRollup(void) {
+  tiers_[0].period = 60;
+  tiers_[0].capacity = ROLLUP_MINUTES;
+  tiers_[0].rows = minute_rows_;
+  tiers_[1].period = 3600;
+  tiers_[1].capacity = ROLLUP_HOURS;
+  tiers_[1].rows = hour_rows_;
+  for (uint8_t tier = 0; tier < kTiers; tier++) {
+    tiers_[tier].bucket = 0;
+    tiers_[tier].closed = 0;
+    for (uint8_t slot = 0; slot < ROLLUP_KEYS; slot++) {
+      tiers_[tier].open[slot].count = 0;
+    }
+  }
+  key_count_ = 0;
+}
+
+void SampleRollup::add(uint8_t key_byte, long value, uint32_t seconds) {
+  // Find Slot Of Key, Only The First ROLLUP_KEYS Keys Are Summarized
+  uint8_t slot = 0;
+  while ((slot < key_count_) && ((keys_[slot] & 0x3F) != (key_byte & 0x3F))) {
+    slot++;
+  }
+  if (slot == ROLLUP_KEYS) {
+    return;
+  }
+  if (slot == key_count_) {
+    if (key_count_ == 0) { // first reading opens the first buckets
+      for (uint8_t tier = 0; tier < kTiers; tier++) {
+        tiers_[tier].bucket = seconds / tiers_[tier].period;
+      }
+    }
+    keys_[key_count_++] = key_byte;
+  }
+
+  for (uint8_t tier = 0; tier < kTiers; tier++) {
+    // Close Buckets Up To The Reading, A Clock Step Back Stays In The Open Bucket
+    Tier &t = tiers_[tier];
+    uint32_t bucket = seconds / t.period;
+    if (bucket > t.bucket) {
+      uint32_t gap = bucket - t.bucket - 1;
+      closeBucket(tier);
+      for (uint32_t i = 0; (i < gap) && (i < t.capacity); i++) {
+        closeBucket(tier);
+      }
+      t.bucket = bucket;
+    }
+
+    // Accumulate Reading In Open Bucket
+    Accumulator &open = t.open[slot];
+    if (open.count == 0) {
+      open.minimum = value;
+      open.maximum = value;
+      open.mean = value;
+    }
+    else {
+      if (value < open.minimum) {
+        open.minimum = value;
+      }
+      if (value > open.maximum) {
+        open.maximum = value;
+      }
+      open.mean += (value - open.mean) / (open.count + 1);
+    }
+    if (open.count < kMaxCount) {
+      open.count++;
+    }
+  }
+}
+
+uint8_t SampleRollup::countRows(uint8_t tier, uint32_t seconds) {
+  // Rows Held End At The Open Bucket
+  Tier &t = tiers_[tier];
+  uint8_t rows = (t.closed < t.capacity) ? t.closed : t.capacity;
+  while ((rows > 0) && ((t.bucket - rows) * t.period < seconds)) {
+    rows--;
+  }
+  return rows;
+}
+
+uint16_t SampleRollup::sizeFrame(uint8_t tier, uint8_t rows) {
+  return kRollupHeaderSize + key_count_ + (uint16_t)rows * key_count_ * kRollupSummarySize;
+}
+
+void SampleRollup::printFrame(Print &out, uint8_t tier, uint8_t rows) {
+  // Header: Period, Time Of First Row, Rows & Keys
+  Tier &t = tiers_[tier];
+  uint32_t start = (t.bucket - rows) * t.period;
+  out.write(kRollupFrame);
+  out.write((uint8_t)t.period);
+  out.write((uint8_t)(t.period >> 8));
+  for (uint8_t i = 0; i < 4; i++) {
+    out.write((uint8_t)(start >> (8 * i)));
+  }
+  out.write(rows);
+  out.write(key_count_);
+  out.write(keys_, key_count_);
+
+  // Rows, Oldest First
+  for (uint32_t n = t.closed - rows; n < t.closed; n++) {
+    Summary *row = &t.rows[(n % t.capacity) * ROLLUP_KEYS];
+    for (uint8_t slot = 0; slot < key_count_; slot++) {
+      int16_t fields[4] = {row[slot].minimum, row[slot].maximum, row[slot].mean, (int16_t)row[slot].count};
+      for (uint8_t i = 0; i < 4; i++) {
+        out.write((uint8_t)fields[i]);
+        out.write((uint8_t)((uint16_t)fields[i] >> 8));
+      }
+    }
+  }
+}
+
+uint8_t SampleRollup::getKeys(void) {
+  return key_count_;
+}
+
+SampleHistory::SampleHistory(KeyDictionary &keys, SyncedClock &clock) : keys_(keys), clock_(clock) {
+  time = 0;
+  end_ = 0;
+}
+
+void SampleHistory::add(const char *code, int id, long value, uint8_t decimals) {
+  // Number Key, Keys Not In The Dictionary Are Not Recorded
+  int key = keys_.find(packCode(code), id);
+  if ((key < 0) || (key > 0x3F) || (decimals > 3)) {
+    return;
+  }
+  if (value > kMaxValue) {
+    value = kMaxValue;
+  }
+  else if (value < -kMaxValue) {
+    value = -kMaxValue;
+  }
+  uint8_t key_byte = (decimals << 6) | key;
+
+#if SAMPLE_ROLLUP
+  // Summarize Every Reading
+  uint32_t seconds;
+  uint16_t milliseconds;
+  clock_.getTime(time, seconds, milliseconds);
+  rollup.add(key_byte, value, seconds);
+#endif
+
+  // Leave Out Reading Equal To The Last Record Of Its Key
+  for (uint32_t n = end_; n > begin(); n--) {
+    Record &record = records_[(n - 1) % SAMPLE_HISTORY_RECORDS];
+    if ((record.key & 0x3F) == key) {
+      long last = (long)((uint32_t)record.value[0] | ((uint32_t)record.value[1] << 8) |
+                         ((uint32_t)record.value[2] << 16) | ((record.value[2] & 0x80) ? 0xFF000000UL : 0));
+      if ((record.key == key_byte) && (last == value)) {
+        return;
+      }
+      break;
+    }
+  }
+
+  // Record Reading, Overwriting The Oldest Once The Ring Is Full
+  Record &record = records_[end_ % SAMPLE_HISTORY_RECORDS];
+  record.time = time;
+  record.key = key_byte;
+  for (uint8_t i = 0; i < 3; i++) {
+    record.value[i] = value >> (8 * i);
+  }
+  end_++;
+}
+
+uint32_t SampleHistory::begin(void) {
+  return (end_ > SAMPLE_HISTORY_RECORDS) ? end_ - SAMPLE_HISTORY_RECORDS : 0;
+}
+
+uint32_t SampleHistory::end(void) {
+  return end_;
+}
+
+uint32_t SampleHistory::find(uint32_t seconds) {
+  for (uint32_t n = begin(); n < end_; n++) {
+    uint32_t record_seconds;
+    uint16_t record_milliseconds;
+    clock_.getTime(records_[n % SAMPLE_HISTORY_RECORDS].time, record_seconds, record_milliseconds);
+    if (record_seconds >= seconds) {
+      return n;
+    }
+  }
+  return end_;
+}
+
+uint16_t SampleHistory::sizeFrame(uint32_t first, uint8_t &count) {
+  // Fill Frame, Long Gaps Take 2 More Bytes
+  uint16_t size = kHistoryHeaderSize;
+  count = 0;
+  uint8_t gap[4];
+  for (uint32_t n = first; (n < end_) && (count < kFrameRecords); n++) {
+    size += kHistoryRecordSize - 2 + encodeGap(first, n, gap);
+    count++;
+  }
+  return size;
+}
+
+void SampleHistory::printFrame(Print &out, uint32_t first, uint8_t count) {
+  // Header: Controller Time Of First Record
+  uint32_t seconds;
+  uint16_t milliseconds;
+  clock_.getTime(records_[first % SAMPLE_HISTORY_RECORDS].time, seconds, milliseconds);
+  out.write(kHistoryFrame);
+  for (uint8_t i = 0; i < 4; i++) {
+    out.write((uint8_t)(seconds >> (8 * i)));
+  }
+  out.write((uint8_t)milliseconds);
+  out.write((uint8_t)(milliseconds >> 8));
+
+  // Records: Key, Time Since Previous Record & Value
+  uint8_t gap[4];
+  for (uint32_t n = first; n < first + count; n++) {
+    Record &record = records_[n % SAMPLE_HISTORY_RECORDS];
+    out.write(record.key);
+    out.write(gap, encodeGap(first, n, gap));
+    out.write(record.value, 3);
+  }
+}
+
+//-------------------------------------------------PRIVATE-------------------------------------------//
+void SampleRollup::closeBucket(uint8_t tier) {
+  // Summarize Open Bucket Of Each Key In The Next Row
+  Tier &t = tiers_[tier];
+  Summary *row = &t.rows[(t.closed % t.capacity) * ROLLUP_KEYS];
+  for (uint8_t slot = 0; slot < ROLLUP_KEYS; slot++) {
+    Accumulator &open = t.open[slot];
+    Summary &summary = row[slot];
+    if (open.count == 0) {
+      summary.minimum = 0;
+      summary.maximum = 0;
+      summary.mean = 0;
+      summary.count = 0;
+      continue;
+    }
+
+    // Scale Values Down Until They Fit In 16 Bits
+    long values[3] = {open.minimum, open.maximum, (long)(open.mean + ((open.mean < 0) ? -0.5 : 0.5))};
+    uint8_t scale = 0;
+    for (uint8_t i = 0; i < 3; i++) {
+      while ((scale < 3) && ((values[i] > 0x7FFF) || (values[i] < -0x7FFF))) {
+        scale++;
+        for (uint8_t j = 0; j < 3; j++) {
+          values[j] = (values[j] + ((values[j] < 0) ? -5 : 5)) / 10;
+        }
+      }
+      if (values[i] > 0x7FFF) {
+        values[i] = 0x7FFF;
+      }
+      else if (values[i] < -0x7FFF) {
+        values[i] = -0x7FFF;
+      }
+    }
+    summary.minimum = values[0];
+    summary.maximum = values[1];
+    summary.mean = values[2];
+    summary.count = ((uint16_t)scale << 14) | open.count;
+    open.count = 0;
+  }
+  t.closed++;
+}
+
+uint8_t SampleHistory::encodeGap(uint32_t first, uint32_t n, uint8_t *bytes) {
+  // Milliseconds Since The Previous Record Of The Frame, None Before The First Or Back In Time
+  int32_t difference = (n > first) ? getTimeDifference(n - 1, n) : 0;
+  uint32_t gap = (difference > 0) ? difference : 0;
+  uint8_t size = 0;
+  if (gap >= kHistoryLongTime) {
+    bytes[size++] = gap >> 16;
+    bytes[size++] = (gap >> 24) | 0x80;
+  }
+  bytes[size++] = gap;
+  bytes[size++] = gap >> 8;
+  return size;
+}
+
+int32_t SampleHistory::getTimeDifference(uint32_t from, uint32_t to) {
+  // Milliseconds Between Records In Controller Time
+  uint32_t from_seconds, to_seconds;
+  uint16_t from_milliseconds, to_milliseconds;
+  clock_.getTime(records_[from % SAMPLE_HISTORY_RECORDS].time, from_seconds, from_milliseconds);
+  clock_.getTime(records_[to % SAMPLE_HISTORY_RECORDS].time, to_seconds, to_milliseconds);
+  return (int32_t)(to_seconds - from_seconds) * 1000 + to_milliseconds - from_milliseconds;
+}
@@ -0,0 +1,222 @@
+/**
+ *  \file support_history.h
+ *  \brief Support module that keeps the latest readings in RAM for the controller to download.
+ *  \details A fixed size ring of 8 byte records: the millis() at which the reading was
+ *  sampled, the number of its key in the KeyDictionary (see support_message.h), and the
+ *  reading as a 24 bit fixed point value with its number of decimals. A reading is only
+ *  recorded when it differs from the last record of its key still in the ring, so relays
+ *  and switches that never change do not push sensor readings out. A key keeps its last
+ *  recorded value until its next record. Nothing is allocated and there are no Strings.
+ *
+ *  Records are downloaded oldest first as binary history frames of up to kFrameRecords
+ *  records, each frame:
+ *  - kHistoryFrame, then the controller time of the first record: unix seconds (4 bytes)
+ *    and milliseconds (2 bytes), little endian
+ *  - per record: a key byte, decimals in bits 7-6 and key number in bits 5-0, the
+ *    milliseconds since the previous record of the frame and the value times 10^decimals
+ *    (3 bytes), little endian
+ *  - the milliseconds take 2 bytes below 32768, otherwise 4: the high 15 bits with bit 15
+ *    set, then the low 16 bits. A record sampled before the previous one (e.g. after the
+ *    clock was set back) has 0 milliseconds
+ *  Example: SATM 1 at 19.2 (key 12) 1.5 s after the previous record is 0x4C 0xDC 0x05 0xC0 0x00 0x00.
+ *  The ring holds SAMPLE_HISTORY_RECORDS records, which can be set at compile time.
+ *
+ *  Unless SAMPLE_ROLLUP is set to 0 at compile time, every reading, changed or not, is also
+ *  summarized by a SampleRollup in two tiers of fixed size: per minute and per hour of
+ *  controller time, the min, max, mean and count of each of the first ROLLUP_KEYS keys
+ *  recorded. Buckets are aligned to the controller clock (uptime until it is set) and close
+ *  when the first reading of the next bucket is added, a bucket without readings has a
+ *  count of 0. A clock step forward counts as a gap. The tiers hold the last ROLLUP_MINUTES
+ *  minutes and ROLLUP_HOURS hours, 8 bytes per key each, which can be set at compile time.
+ *  A tier is downloaded as a single rollup frame:
+ *  - kRollupFrame, the bucket period in seconds (2 bytes), the controller time of the first
+ *    row in unix seconds (4 bytes), the number of rows and the number of keys (1 byte each)
+ *  - a key byte per key, as in a history frame
+ *  - per row, oldest first, per key: min, max and mean times 10^decimals (2 bytes each) and
+ *    the count in bits 13-0 (2 bytes), little endian. If a value did not fit in 16 bits, all
+ *    three are divided by 10^scale, with scale in bits 15-14 of the count
+ *  Example: 24 hours of 10 keys is a frame of 1939 bytes.
+ *  The rollup takes 27 + ROLLUP_KEYS * (29 + 8 * rows) bytes of RAM, 1197 at the default
+ *  sizes, next to the 512 bytes of the ring. A full day of hours costs 1440 bytes more.
+ *  \author Jake Rye
+ */
+#ifndef SUPPORT_HISTORY_H
+#define SUPPORT_HISTORY_H
+
+#if ARDUINO >= 100
+ #include "Arduino.h"
+#else
+ #include "WProgram.h"
+#endif
+
+#include "support_clock.h"
+#include "support_message.h"
+
+#ifndef SAMPLE_HISTORY_RECORDS
+#define SAMPLE_HISTORY_RECORDS 64 // 8 bytes of RAM each
+#endif
+#ifndef SAMPLE_ROLLUP
+#define SAMPLE_ROLLUP 1 // 0 leaves out the minute & hour summaries of GHST 2 & 3
+#endif
+#ifndef ROLLUP_KEYS
+#define ROLLUP_KEYS 10 // keys summarized, 29 bytes of RAM each plus 8 per row
+#endif
+#ifndef ROLLUP_MINUTES
+#define ROLLUP_MINUTES 5 // rows of the minute tier
+#endif
+#ifndef ROLLUP_HOURS
+#define ROLLUP_HOURS 6 // rows of the hour tier
+#endif
+
+/**
+ * \brief Support module that summarizes readings per minute and per hour.
+ */
+class SampleRollup {
+  public:
+    // Public Functions
+    SampleRollup(void);
+
+    /**
+     * \brief Adds value, the reading of the key of key_byte (as in a history record),
+     * sampled at controller time seconds.
+     */
+    void add(uint8_t key_byte, long value, uint32_t seconds);
+
+    /**
+     * \brief Returns the number of closed rows of tier (0 minutes, 1 hours) that start at or
+     * after unix time seconds.
+     */
+    uint8_t countRows(uint8_t tier, uint32_t seconds);
+
+    /**
+     * \brief Returns the number of bytes of the rollup frame of the last rows rows of tier.
+     */
+    uint16_t sizeFrame(uint8_t tier, uint8_t rows);
+
+    /**
+     * \brief Prints the rollup frame of the last rows rows of tier.
+     */
+    void printFrame(Print &out, uint8_t tier, uint8_t rows);
+
+    /**
+     * \brief Returns the number of keys summarized so far.
+     */
+    uint8_t getKeys(void);
+
+  private:
+    // Private Functions
+    void closeBucket(uint8_t tier);
+
+    // Private Variables
+    struct Accumulator {
+      long minimum;
+      long maximum;
+      float mean;
+      uint16_t count;
+    };
+    struct Summary {
+      int16_t minimum;
+      int16_t maximum;
+      int16_t mean;
+      uint16_t count; // scale in bits 15-14, count in bits 13-0
+    };
+    struct Tier {
+      uint16_t period; // seconds
+      uint8_t capacity; // rows
+      Summary *rows; // capacity rows of ROLLUP_KEYS summaries
+      uint32_t bucket; // controller time of the open bucket / period
+      uint32_t closed; // rows closed
+      Accumulator open[ROLLUP_KEYS];
+    };
+    static const uint8_t kTiers = 2;
+    static const uint16_t kMaxCount = 0x3FFF;
+    Tier tiers_[kTiers];
+    Summary minute_rows_[ROLLUP_MINUTES * ROLLUP_KEYS];
+    Summary hour_rows_[ROLLUP_HOURS * ROLLUP_KEYS];
+    uint8_t keys_[ROLLUP_KEYS]; // key bytes
+    uint8_t key_count_;
+};
+
+/**
+ * \brief Support module that keeps the latest readings in RAM for the controller to download.
+ */
+class SampleHistory {
+  public:
+    // Public Functions
+    /**
+     * \brief Numbers keys as keys does, readings of keys not in it are not recorded.
+     * Times are told by clock.
+     */
+    SampleHistory(KeyDictionary &keys, SyncedClock &clock);
+
+    /**
+     * \brief Records value, the reading of "<code> <id>" times 10^decimals, as sampled at
+     * time, if it changed, and adds it to the rollup if there is one. Called by a MessageWriter given this history.
+     */
+    void add(const char *code, int id, long value, uint8_t decimals);
+
+    /**
+     * \brief Returns the sequence number of the oldest record still in the ring.
+     * Records are numbered from 0 in the order they were recorded.
+     */
+    uint32_t begin(void);
+
+    /**
+     * \brief Returns the sequence number the next record will get.
+     */
+    uint32_t end(void);
+
+    /**
+     * \brief Returns the sequence number of the first record sampled at or after unix time
+     * seconds, or end() if there is none.
+     */
+    uint32_t find(uint32_t seconds);
+
+    /**
+     * \brief Returns the number of bytes of the history frame that starts at record first.
+     * Sets count to the number of records that go in it.
+     */
+    uint16_t sizeFrame(uint32_t first, uint8_t &count);
+
+    /**
+     * \brief Prints the history frame of count records that starts at record first.
+     */
+    void printFrame(Print &out, uint32_t first, uint8_t count);
+
+    // Public Variables
+    uint32_t time; // millis() at which the readings added next were sampled
+#if SAMPLE_ROLLUP
+    SampleRollup rollup; // minute & hour summaries
+#endif
+
+  private:
+    // Private Functions
+    uint8_t encodeGap(uint32_t first, uint32_t n, uint8_t *bytes);
+    int32_t getTimeDifference(uint32_t from, uint32_t to);
+
+    // Private Variables
+    struct Record {
+      uint32_t time; // millis()
+      uint8_t key; // decimals in bits 7-6, key number in bits 5-0
+      uint8_t value[3]; // little endian, two's complement
+    };
+    static const uint8_t kFrameRecords = 40;
+    static const long kMaxValue = 0x7FFFFF;
+    KeyDictionary &keys_;
+    SyncedClock &clock_;
+    Record records_[SAMPLE_HISTORY_RECORDS];
+    uint32_t end_;
+};
+
+// History Frame Format
+const uint8_t kHistoryFrame = 0x81; // first byte of a history frame
+const uint8_t kHistoryHeaderSize = 7;
+const uint8_t kHistoryRecordSize = 6; // 8 with a long time difference
+const uint16_t kHistoryLongTime = 0x8000; // time differences from here take 4 bytes
+
+// Rollup Frame Format
+const uint8_t kRollupFrame = 0x82; // first byte of a rollup frame
+const uint8_t kRollupHeaderSize = 9; // plus a key byte per key
+const uint8_t kRollupSummarySize = 8;
+
+#endif // SUPPORT_HISTORY_H_
@@ -0,0 +1,442 @@
+/** 
+ *  \file support_message.cpp
+ *  \brief Support module for writing messages without the heap.
+ *  \details See support_message.h for details.
+ *  \author Jake Rye
+ */
+#include "support_message.h"
+
+#include "support_history.h"
+
+//--------------------------------------------------PUBLIC-------------------------------------------//
+uint32_t packCode(const char *code) {
+  uint32_t packed = 0;
+  for (int i = 0; i < 4; i++) {
+    packed <<= 8;
+    if (*code != '\0' && *code != ' ') {
+      packed |= (uint8_t)*code++;
+    }
+  }
+  return packed;
+}
+
+MessageBuffer::MessageBuffer(char *buffer, uint16_t size) {
+  buffer_ = buffer;
+  size_ = size;
+  clear();
+}
+
+size_t MessageBuffer::write(uint8_t c) {
+  if (length_ + 1 >= size_) { // keep room for the terminator
+    overflowed_ = true;
+    return 0;
+  }
+  buffer_[length_++] = c;
+  buffer_[length_] = '\0';
+  return 1;
+}
+
+void MessageBuffer::rewind(uint16_t length) {
+  if (length < length_) {
+    length_ = length;
+    buffer_[length_] = '\0';
+  }
+  overflowed_ = false;
+}
+
+void MessageBuffer::clear(void) {
+  length_ = 0;
+  buffer_[0] = '\0';
+  overflowed_ = false;
+}
+
+const char *MessageBuffer::c_str(void) {
+  return buffer_;
+}
+
+uint16_t MessageBuffer::length(void) {
+  return length_;
+}
+
+bool MessageBuffer::overflowed(void) {
+  return overflowed_;
+}
+
+MessageCounter::MessageCounter(void) {
+  length_ = 0;
+}
+
+size_t MessageCounter::write(uint8_t c) {
+  length_++;
+  return 1;
+}
+
+uint16_t MessageCounter::length(void) {
+  return length_;
+}
+
+ChangeFilter::ChangeFilter(void) {
+  keyframe = true;
+  record = false;
+  key_count_ = 0;
+  cursor_ = 0;
+}
+
+bool ChangeFilter::check(const char *code, int id, long value, uint8_t decimals) {
+  // Find Key, Keys That Do Not Fit The Table Are Always Sent
+  int i = addKey(code, id);
+  if (i < 0) {
+    return true;
+  }
+  Key &key = keys_[i];
+
+  // Compare To Last Sent Value
+  if (!keyframe && key.sent) {
+    float deadband = key.deadband;
+    for (uint8_t d = 0; d < decimals; d++) {
+      deadband *= 10;
+    }
+    long change = labs(value - key.value);
+    if ((change == 0) || (change <= deadband)) {
+      return false;
+    }
+  }
+
+  // Record Value As Sent
+  if (record) {
+    key.value = value;
+    key.sent = true;
+  }
+  return true;
+}
+
+bool ChangeFilter::setDeadband(const char *code, int id, float deadband) {
+  int i = addKey(code, id);
+  if (i < 0) {
+    return false;
+  }
+  keys_[i].deadband = deadband;
+  return true;
+}
+
+CodeTable::CodeTable(void) {
+  size_ = 0;
+}
+
+bool CodeTable::add(uint32_t code) {
+  // Insert In Sorted Position, Once
+  if (find(code) >= 0) {
+    return true;
+  }
+  if (size_ >= kMaxCodes) {
+    return false;
+  }
+  int i = size_;
+  while ((i > 0) && (codes_[i - 1] > code)) {
+    codes_[i] = codes_[i - 1];
+    i--;
+  }
+  codes_[i] = code;
+  size_++;
+  return true;
+}
+
+int CodeTable::find(uint32_t code) {
+  // Binary Search
+  int low = 0;
+  int high = size_ - 1;
+  while (low <= high) {
+    int middle = (low + high) / 2;
+    if (codes_[middle] < code) {
+      low = middle + 1;
+    }
+    else if (codes_[middle] > code) {
+      high = middle - 1;
+    }
+    else {
+      return middle;
+    }
+  }
+  return -1;
+}
+
+void CodeTable::print(Print &out) {
+  out.print('[');
+  for (uint8_t i = 0; i < size_; i++) {
+    out.print(i ? ",\"" : "\"");
+    for (int8_t shift = 24; shift >= 0; shift -= 8) {
+      char c = (codes_[i] >> shift) & 0xFF;
+      if (c) {
+        out.print(c);
+      }
+    }
+    out.print('"');
+  }
+  out.print(']');
+}
+
+KeyDictionary::KeyDictionary(void) {
+  size_ = 0;
+}
+
+bool KeyDictionary::add(uint32_t code, int id) {
+  // Insert In Sorted Position, Once
+  if (find(code, id) >= 0) {
+    return true;
+  }
+  if (size_ >= kMaxKeys) {
+    return false;
+  }
+  int i = size_;
+  while ((i > 0) && ((keys_[i - 1].code > code) || ((keys_[i - 1].code == code) && (keys_[i - 1].id > id)))) {
+    keys_[i] = keys_[i - 1];
+    i--;
+  }
+  keys_[i].code = code;
+  keys_[i].id = id;
+  keys_[i].decimals = 0;
+  size_++;
+  return true;
+}
+
+int KeyDictionary::find(uint32_t code, int id) {
+  // Binary Search
+  int low = 0;
+  int high = size_ - 1;
+  while (low <= high) {
+    int middle = (low + high) / 2;
+    if ((keys_[middle].code < code) || ((keys_[middle].code == code) && (keys_[middle].id < id))) {
+      low = middle + 1;
+    }
+    else if ((keys_[middle].code > code) || (keys_[middle].id > id)) {
+      high = middle - 1;
+    }
+    else {
+      return middle;
+    }
+  }
+  return -1;
+}
+
+uint8_t KeyDictionary::size(void) {
+  return size_;
+}
+
+uint32_t KeyDictionary::code(uint8_t key) {
+  return keys_[key].code;
+}
+
+int KeyDictionary::id(uint8_t key) {
+  return keys_[key].id;
+}
+
+uint8_t KeyDictionary::decimals(uint8_t key) {
+  return keys_[key].decimals;
+}
+
+void KeyDictionary::setDecimals(uint8_t key, uint8_t decimals) {
+  keys_[key].decimals = decimals;
+}
+
+MessageWriter::MessageWriter(Print &out, ChangeFilter *filter, CodeTable *codes, KeyDictionary *keys,
+                             SampleHistory *history) : out(out) {
+  filter_ = filter;
+  codes_ = codes;
+  keys_ = keys;
+  history_ = history;
+}
+
+bool MessageWriter::binary(void) {
+  return codes_ != NULL;
+}
+
+bool MessageWriter::recording(void) {
+  return history_ != NULL;
+}
+
+void MessageWriter::add(const char *code, int id, float value, uint8_t decimals) {
+  // Scale To Fixed Point
+  int key = findKey(code, id, decimals);
+  if (binary() && (key < 0) && (decimals > kRecordMaxDecimals)) {
+    decimals = kRecordMaxDecimals;
+  }
+  float scaled = value;
+  for (uint8_t d = 0; d < decimals; d++) {
+    scaled *= 10;
+  }
+
+  // Record & Leave Out Unchanged Reading
+  if (history_) {
+    history_->add(code, id, lround(scaled), decimals);
+  }
+  if (filter_ && !filter_->check(code, id, lround(scaled), decimals)) {
+    return;
+  }
+
+  // Append Reading
+  if (binary()) {
+    addRecord(code, id, lround(scaled), decimals, key);
+    return;
+  }
+  addKey(code, id, key);
+  out.print(value, decimals);
+  out.print(',');
+}
+
+void MessageWriter::add(const char *code, int id, long value) {
+  // Scale To Fixed Point, In Case The Dictionary Has Decimals
+  uint8_t decimals = 0;
+  int key = findKey(code, id, decimals);
+  long scaled = value;
+  for (uint8_t d = 0; d < decimals; d++) {
+    scaled *= 10;
+  }
+
+  // Record & Leave Out Unchanged Reading
+  if (history_) {
+    history_->add(code, id, scaled, decimals);
+  }
+  if (filter_ && !filter_->check(code, id, scaled, decimals)) {
+    return;
+  }
+
+  // Append Reading
+  if (binary()) {
+    addRecord(code, id, scaled, decimals, key);
+    return;
+  }
+  addKey(code, id, key);
+  out.print(value);
+  out.print(',');
+}
+
+void MessageWriter::addText(const char *code, int id, const __FlashStringHelper *text) {
+  if (binary()) {
+    PGM_P chars = reinterpret_cast<PGM_P>(text);
+    uint8_t length = strlen_P(chars) > 255 ? 255 : strlen_P(chars);
+    if (keys_) {
+      out.write(kKeyRecordFull);
+    }
+    addRecordKey(code, id, kRecordText, 0);
+    out.write(length);
+    for (uint8_t n = 0; n < length; n++) {
+      out.write(pgm_read_byte(chars + n));
+    }
+    return;
+  }
+  addKey(code, id, -1);
+  out.print('"');
+  out.print(text);
+  out.print(F("\","));
+}
+
+//-------------------------------------------------PRIVATE-------------------------------------------//
+int MessageWriter::findKey(const char *code, int id, uint8_t &decimals) {
+  // Look Up Key & Apply Its Precision
+  if (!keys_) {
+    return -1;
+  }
+  int key = keys_->find(packCode(code), id);
+  if (key >= 0) {
+    decimals = keys_->decimals(key);
+  }
+  return key;
+}
+
+void MessageWriter::addKey(const char *code, int id, int key) {
+  // Key Number If The Controller Has The Dictionary
+  if (key >= 0) {
+    out.print('"');
+    out.print(key);
+    out.print("\":");
+    return;
+  }
+
+  // Full Key
+  out.print('"');
+  out.print(code);
+  out.print(' ');
+  out.print(id);
+  out.print("\":");
+}
+
+int ChangeFilter::findKey(const char *code, int id) {
+  // Search From The Key After The Last Hit
+  uint32_t packed = packCode(code);
+  for (uint8_t n = 0; n < key_count_; n++) {
+    uint8_t i = (cursor_ + n) % key_count_;
+    if ((keys_[i].code == packed) && (keys_[i].id == id)) {
+      cursor_ = (i + 1) % key_count_;
+      return i;
+    }
+  }
+  return -1;
+}
+
+int ChangeFilter::addKey(const char *code, int id) {
+  // Find Key, Or Add It If The Table Has Room
+  int i = findKey(code, id);
+  if (i >= 0) {
+    return i;
+  }
+  if (key_count_ >= kMaxKeys) {
+    return -1;
+  }
+  Key &key = keys_[key_count_];
+  key.code = packCode(code);
+  key.id = id;
+  key.value = 0;
+  key.deadband = 0;
+  key.sent = false;
+  cursor_ = 0;
+  return key_count_++;
+}
+
+void MessageWriter::addRecord(const char *code, int id, long value, uint8_t decimals, int key) {
+  // Key Byte & Value If The Controller Has The Dictionary
+  if (key >= 0) {
+    if ((decimals == 0) && ((value == 0) || (value == 1))) {
+      out.write((uint8_t)(((value ? kKeyRecordTrue : kKeyRecordFalse) << 6) | key));
+      return;
+    }
+    bool fits = (value >= -32768) && (value <= 32767);
+    out.write((uint8_t)(((fits ? kKeyRecordInt16 : kKeyRecordInt32) << 6) | key));
+    for (uint8_t i = 0; i < (fits ? 2 : 4); i++) {
+      out.write((uint8_t)(value >> (8 * i)));
+    }
+    return;
+  }
+  if (keys_) {
+    out.write(kKeyRecordFull);
+  }
+
+  // Booleans Fit In The ID Byte
+  if ((decimals == 0) && ((value == 0) || (value == 1))) {
+    addRecordKey(code, id, kRecordBoolean, value);
+    return;
+  }
+
+  // Smallest Integer That Holds The Value, Little Endian
+  uint8_t size = 4;
+  uint8_t type = kRecordInt32;
+  if ((value >= -32768) && (value <= 32767)) {
+    size = 2;
+    type = kRecordInt16;
+  }
+  addRecordKey(code, id, type, decimals);
+  for (uint8_t i = 0; i < size; i++) {
+    out.write((uint8_t)(value >> (8 * i)));
+  }
+}
+
+void MessageWriter::addRecordKey(const char *code, int id, uint8_t type, uint8_t flags) {
+  int index = codes_->find(packCode(code));
+  if (index < 0) {
+    out.write((uint8_t)((type << 6) | kRecordInlineCode));
+    out.write((const uint8_t *)code, 4);
+  }
+  else {
+    out.write((uint8_t)((type << 6) | index));
+  }
+  out.write((uint8_t)((flags << 6) | (id & 0x3F)));
+}
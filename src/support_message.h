@@ -0,0 +1,284 @@
+/** 
+ *  \file support_message.h
+ *  \brief Support module for writing messages without the heap.
+ *  \details Modules append their readings to a MessageWriter, which formats each one as
+ *  "<instruction_code> <instruction_id>":<value>, and hands the characters straight to a
+ *  Print: a MessageBuffer over a preallocated char array, or the serial port itself.
+ *  Nothing is allocated, so the size of a message no longer depends on free heap.
+ *  A MessageWriter can be given a ChangeFilter, which leaves out readings that have not
+ *  changed by more than their deadband since they were last sent.
+ *
+ *  Given a CodeTable, a MessageWriter writes binary records instead of JSON. A record is
+ *  a key byte, an id byte and the value:
+ *  - key byte: type in bits 7-6, number of the code in the CodeTable in bits 5-0, or 63
+ *    followed by the 4 characters of a code that is not in the table
+ *  - id byte: bits 7-6 are the number of decimals (boolean: the value), bits 5-0 the id
+ *  - type 0 boolean, no value bytes, for integer readings of 0 or 1
+ *  - type 1 int16 and type 2 int32, little endian, the reading times 10^decimals
+ *  - type 3 text, a length byte followed by the characters
+ *  Example: "SATM 1":19.2, (14 bytes) is 0x4D 0x41 0xC0 0x00 (4 bytes) if SATM is code 13.
+ *
+ *  Given a KeyDictionary as well, JSON keys in the dictionary are written as their number,
+ *  e.g. "12":19.2, and binary records as a single key byte followed by the value: type in
+ *  bits 7-6, number of the key in bits 5-0. The precision comes from the dictionary.
+ *  - type 0 false and type 1 true, no value bytes
+ *  - type 2 int16 and type 3 int32, little endian, the reading times 10^decimals
+ *  - key number 63 is followed by a full record as above, for text & keys not in the table
+ *  Example: "SATM 1":19.2, is 0x8C 0xC0 0x00 (3 bytes) if SATM 1 is key 12.
+ *  \author Jake Rye
+ */
+#ifndef SUPPORT_MESSAGE_H
+#define SUPPORT_MESSAGE_H
+
+#if ARDUINO >= 100
+ #include "Arduino.h"
+#else
+ #include "WProgram.h"
+#endif
+
+/**
+ * \brief Packs a 4 character instruction code into an integer, first character highest, so
+ * packed codes sort alphabetically. Stops at the end of the string or a space.
+ */
+uint32_t packCode(const char *code);
+
+class SampleHistory;
+
+/**
+ * \brief Print over a fixed size char array. Always null terminated.
+ * Characters that do not fit are dropped and overflowed() is set.
+ */
+class MessageBuffer : public Print {
+  public:
+    // Public Functions
+    MessageBuffer(char *buffer, uint16_t size);
+    size_t write(uint8_t c);
+    using Print::write;
+
+    /**
+     * \brief Truncates the message to length characters and clears overflowed().
+     * Used to take back a partly written reading.
+     */
+    void rewind(uint16_t length);
+
+    void clear(void);
+    const char *c_str(void);
+    uint16_t length(void);
+    bool overflowed(void);
+
+  private:
+    // Private Variables
+    char *buffer_;
+    uint16_t size_;
+    uint16_t length_;
+    bool overflowed_;
+};
+
+/**
+ * \brief Print that only counts the characters written to it.
+ * Used for a sizing pass, so a message can be framed before it is written out.
+ */
+class MessageCounter : public Print {
+  public:
+    // Public Functions
+    MessageCounter(void);
+    size_t write(uint8_t c);
+    using Print::write;
+    uint16_t length(void);
+
+  private:
+    // Private Variables
+    uint16_t length_;
+};
+
+/**
+ * \brief Remembers the last value sent under each key, so unchanged readings can be left out.
+ * Values are compared as printed, in units of their last decimal, so 6.0 and 6.04 printed
+ * with one decimal are the same reading. Keys that do not fit the table are always sent.
+ */
+class ChangeFilter {
+  public:
+    // Public Functions
+    ChangeFilter(void);
+
+    /**
+     * \brief Returns true if value, printed with the given number of decimals, should be
+     * sent under "<code> <id>". Records it as sent if record is set.
+     */
+    bool check(const char *code, int id, long value, uint8_t decimals);
+
+    /**
+     * \brief Sets the smallest change of "<code> <id>" that is sent, 0 by default so that
+     * any change of the printed value is sent. Adds the key if it is not tracked yet, the
+     * caller checks it is one the board sends.
+     * Returns false if the table is full.
+     */
+    bool setDeadband(const char *code, int id, float deadband);
+
+    // Public Variables
+    bool keyframe; // send every key regardless of change
+    bool record; // check() records the values it passes as sent
+
+  private:
+    // Private Functions
+    int findKey(const char *code, int id);
+    int addKey(const char *code, int id);
+
+    // Private Variables
+    struct Key {
+      uint32_t code; // 4 characters packed
+      int id;
+      long value; // last value sent, in units of its last decimal
+      float deadband;
+      bool sent;
+    };
+    static const uint8_t kMaxKeys = 32;
+    Key keys_[kMaxKeys];
+    uint8_t key_count_;
+    uint8_t cursor_; // keys come in the same order every message, search starts after the last hit
+};
+
+/**
+ * \brief Sorted table of instruction codes, numbered in alphabetical order.
+ * Binary messages send the number of a code instead of its 4 characters.
+ */
+class CodeTable {
+  public:
+    // Public Functions
+    CodeTable(void);
+
+    /**
+     * \brief Adds a packed code, keeping the table sorted. Returns false if the table is full.
+     */
+    bool add(uint32_t code);
+
+    /**
+     * \brief Returns the number of a packed code, or -1 if it is not in the table.
+     */
+    int find(uint32_t code);
+
+    /**
+     * \brief Prints the table as a JSON array of codes, e.g. ["AACR","AAHE"]
+     */
+    void print(Print &out);
+
+  private:
+    // Private Variables
+    static const uint8_t kMaxCodes = 32; // 17 in the routing table, 63 marks a code sent in full
+    uint32_t codes_[kMaxCodes];
+    uint8_t size_;
+};
+
+/**
+ * \brief Sorted table of keys ("<code> <id>"), numbered in order, with their precision.
+ * Once the controller has the table, messages send the number of a key instead of the
+ * key. Readings of a key are written with its precision, the number of decimals set with
+ * setDecimals() (0 by default), whatever the module prints them with.
+ */
+class KeyDictionary {
+  public:
+    // Public Functions
+    KeyDictionary(void);
+
+    /**
+     * \brief Adds a key, keeping the table sorted. Returns false if the table is full.
+     */
+    bool add(uint32_t code, int id);
+
+    /**
+     * \brief Returns the number of a key, or -1 if it is not in the table.
+     */
+    int find(uint32_t code, int id);
+
+    uint8_t size(void);
+    uint32_t code(uint8_t key);
+    int id(uint8_t key);
+    uint8_t decimals(uint8_t key);
+    void setDecimals(uint8_t key, uint8_t decimals);
+
+  private:
+    // Private Variables
+    struct Key {
+      uint32_t code; // 4 characters packed
+      int id;
+      uint8_t decimals;
+    };
+    static const uint8_t kMaxKeys = 32; // 26 in the routing table, 63 marks a key sent in full
+    Key keys_[kMaxKeys];
+    uint8_t size_;
+};
+
+/**
+ * \brief Formats readings as JSON key value pairs, or as binary records, onto a Print.
+ * Readings left out by the filter, if any, are not written. Text is always written.
+ * Readings are also recorded in the history, if any, see support_history.h.
+ */
+class MessageWriter {
+  public:
+    // Public Functions
+    /**
+     * \brief Writes JSON, or binary records numbering codes with codes if given. Keys in
+     * keys, if given, are written as their number and with the precision of the table.
+     * Readings are recorded in history, if given, with the precision they are written with.
+     */
+    MessageWriter(Print &out, ChangeFilter *filter = NULL, CodeTable *codes = NULL,
+                  KeyDictionary *keys = NULL, SampleHistory *history = NULL);
+
+    /**
+     * \brief Returns true if binary records are written.
+     */
+    bool binary(void);
+
+    /**
+     * \brief Returns true if readings are recorded in a history.
+     */
+    bool recording(void);
+
+    /**
+     * \brief Appends "<code> <id>":<value>, with the given number of decimals.
+     */
+    void add(const char *code, int id, float value, uint8_t decimals);
+
+    /**
+     * \brief Appends "<code> <id>":<value>,
+     */
+    void add(const char *code, int id, long value);
+
+    /**
+     * \brief Appends "<code> <id>":"<text>", text in program memory.
+     * Example: addText("GERR", 4, F("tsl2561 read register timeout"))
+     */
+    void addText(const char *code, int id, const __FlashStringHelper *text);
+
+    // Public Variables
+    Print &out;
+
+  private:
+    // Private Functions
+    int findKey(const char *code, int id, uint8_t &decimals);
+    void addKey(const char *code, int id, int key);
+    void addRecord(const char *code, int id, long value, uint8_t decimals, int key);
+    void addRecordKey(const char *code, int id, uint8_t type, uint8_t flags);
+
+    // Private Variables
+    ChangeFilter *filter_;
+    CodeTable *codes_;
+    KeyDictionary *keys_;
+    SampleHistory *history_;
+};
+
+// Binary Message Format
+const uint8_t kBinaryStream = 0x80; // first byte of a binary stream message, JSON starts with {
+const uint8_t kRecordBoolean = 0;
+const uint8_t kRecordInt16 = 1;
+const uint8_t kRecordInt32 = 2;
+const uint8_t kRecordText = 3;
+const uint8_t kRecordInlineCode = 63;
+const uint8_t kRecordMaxDecimals = 3;
+const uint8_t kKeyRecordFalse = 0;
+const uint8_t kKeyRecordTrue = 1;
+const uint8_t kKeyRecordInt16 = 2;
+const uint8_t kKeyRecordInt32 = 3;
+const uint8_t kKeyRecordFull = 63;
+
+#endif // SUPPORT_MESSAGE_H_
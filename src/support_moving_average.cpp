@@ -12,14 +12,24 @@ MovingAverageFilter::MovingAverageFilter(unsigned int newDataPointsCount) {
   else
   dataPointsCount = MAX_DATA_POINTS;
   
-  for (i=0; i<dataPointsCount; i++) {
-    values[i] = 0; // fill the array with 0's
-  }
+  reset();
+}
+
+void MovingAverageFilter::reset(void) {
+  k = 0;
+  empty = true; // the next data point fills the array
 }
 
 float MovingAverageFilter::process(float in) {
   out = 0;
 
+  if (empty) {
+    for (i=0; i<dataPointsCount; i++) {
+      values[i] = in;
+    }
+    empty = false;
+  }
+
   values[k] = in;
   k = (k+1) % dataPointsCount;
 
@@ -3,7 +3,9 @@
  *  \brief Support module that creates a moving average filter for data.
  *  \details Use is very easy. Construct an instance of the class specifying the number of
  *  data points to be used in the filter. Pass in new data points with the 
- *  *.process method. Method returns updated moving average filtered value.
+ *  *.process method. Method returns updated moving average filtered value. The first data
+ *  point after construction or reset() fills the whole filter, so the average does not
+ *  start from 0 or from the data of another source.
  *  Found at: https://github.com/sebnil/Moving-Avarage-Filter--Arduino-Library-
  */
 #ifndef SUPPORT_MOVING_AVERAGE_H
@@ -18,11 +20,15 @@ public:
 
   float process(float in);
 
+  // forget every data point, e.g. when the source changes
+  void reset(void);
+
 private:
   float values[MAX_DATA_POINTS];
   int k; // k stores the index of the current array read to create a circular memory through the array
   int dataPointsCount;
   float out;
+  bool empty; // no data point since reset()
   int i; // just a loop counter
 };
 #endif // SUPPORT_MOVING_AVERAGE_H_
@@ -109,6 +109,19 @@
 #define DIRECT_WRITE_LOW(base, mask)    ((*(base+8+1)) = (mask))          //LATXCLR  + 0x24
 #define DIRECT_WRITE_HIGH(base, mask)   ((*(base+8+2)) = (mask))          //LATXSET + 0x28
 
+#elif defined(GRO_HOST)
+// Host build, see host/host_hal.h. Same register layout as AVR but every access
+// goes through the host so simulated devices see the bus transitions.
+#define PIN_TO_BASEREG(pin)             (portInputRegister(digitalPinToPort(pin)))
+#define PIN_TO_BITMASK(pin)             (digitalPinToBitMask(pin))
+#define IO_REG_TYPE uint8_t
+#define IO_REG_ASM
+#define DIRECT_READ(base, mask)         ((hostPortRead(base) & (mask)) ? 1 : 0)
+#define DIRECT_MODE_INPUT(base, mask)   (hostPortModeInput((base), (mask)))
+#define DIRECT_MODE_OUTPUT(base, mask)  (hostPortModeOutput((base), (mask)))
+#define DIRECT_WRITE_LOW(base, mask)    (hostPortWriteLow((base), (mask)))
+#define DIRECT_WRITE_HIGH(base, mask)   (hostPortWriteHigh((base), (mask)))
+
 #else
 #error "Please define I/O register types here"
 #endif
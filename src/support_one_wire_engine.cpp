@@ -0,0 +1,269 @@
+/**
+ *  \file support_one_wire_engine.cpp
+ *  \brief Support module that runs 1-wire transactions in the background.
+ *  \details See support_one_wire_engine.h for details.
+ *  \author Jake Rye
+ */
+#include "support_one_wire_engine.h"
+
+//------------------------------------------------TIMER----------------------------------------------//
+#if ONEWIRE_ASYNC && defined(__AVR__)
+#include <avr/interrupt.h>
+
+ISR(TIMER1_COMPA_vect) {
+  OneWireEngine::handleTimer();
+}
+
+static void beginTimer(void) {
+  TCCR1A = 0;
+  TCCR1B = _BV(CS11); // normal mode, clock / 8 counts half microseconds at 16 MHz
+}
+
+static void setTimer(uint16_t us) {
+  OCR1A = TCNT1 + (us << 1);
+  TIFR1 = _BV(OCF1A); // clear a match of the last compare
+  TIMSK1 |= _BV(OCIE1A);
+}
+
+static void stopTimer(void) {
+  TIMSK1 &= ~_BV(OCIE1A);
+}
+
+#elif ONEWIRE_ASYNC && defined(GRO_HOST)
+static void beginTimer(void) {
+}
+
+static void setTimer(uint16_t us) {
+  hostSetTimer(us, OneWireEngine::handleTimer);
+}
+
+static void stopTimer(void) {
+  hostCancelTimer();
+}
+
+#elif ONEWIRE_ASYNC
+#error "ONEWIRE_ASYNC needs Timer1 of an AVR"
+
+#else
+static uint16_t next_delay_ = 0; // microseconds start() waits before the next step
+
+static void setTimer(uint16_t us) {
+  next_delay_ = us;
+}
+
+static void stopTimer(void) {
+}
+#endif
+
+#if defined(GRO_HOST)
+#define DIRECT_READ_PORT(base) (hostPortRead(base))
+#else
+#define DIRECT_READ_PORT(base) (*(base))
+#endif
+
+//--------------------------------------------------PUBLIC-------------------------------------------//
+OneWireEngine * volatile OneWireEngine::active_ = NULL;
+
+OneWireEngine::OneWireEngine(uint8_t pin) {
+  begin(&pin, 1);
+}
+
+OneWireEngine::OneWireEngine(const uint8_t *pins, uint8_t pin_count) {
+  begin(pins, pin_count);
+}
+
+bool OneWireEngine::start(const uint8_t *write_data, uint8_t write_count, uint8_t *read_data, uint8_t read_count,
+                          bool power, uint8_t buses) {
+  if (active_ != NULL) {
+    return false;
+  }
+  bitmask_ = 0;
+  for (uint8_t bus = 0; bus < bus_count_; bus++) {
+    if (buses & (1 << bus)) {
+      bitmask_ |= bitmasks_[bus];
+    }
+  }
+  write_data_ = write_data;
+  write_count_ = write_count;
+  read_data_ = read_data;
+  read_count_ = read_count;
+  bit_ = 0;
+  power_ = power;
+  present_ = 0;
+  phase_ = kResetLow;
+  active_ = this;
+
+#if ONEWIRE_ASYNC
+  // Pull Reset Pulse Now, The Timer Runs The Rest
+  noInterrupts();
+  step();
+  interrupts();
+#else
+  // Run Every Step Here, Interrupts Stay Off Within Slots Only
+  while (active_ == this) {
+    noInterrupts();
+    step();
+    bool slot = (next_delay_ < 100); // the reset waits 480 & 410 us
+    if (slot && (active_ == this)) {
+      delayMicroseconds(next_delay_);
+    }
+    interrupts();
+    if (!slot && (active_ == this)) {
+      delayMicroseconds(next_delay_);
+    }
+  }
+#endif
+  return true;
+}
+
+bool OneWireEngine::isBusy(void) {
+  return active_ == this;
+}
+
+bool OneWireEngine::isPresent(uint8_t bus) {
+  return present_ & (1 << bus);
+}
+
+uint8_t OneWireEngine::getBuses(void) {
+  return bus_count_;
+}
+
+void OneWireEngine::handleTimer(void) {
+  OneWireEngine *engine = active_;
+  if (engine != NULL) {
+    engine->step();
+  }
+}
+
+//-------------------------------------------------PRIVATE-------------------------------------------//
+void OneWireEngine::begin(const uint8_t *pins, uint8_t pin_count) {
+  // Keep Pins On The Port Of The First
+  bus_count_ = (pin_count > kMaxBuses) ? kMaxBuses : pin_count;
+  base_reg_ = PIN_TO_BASEREG(pins[0]);
+  for (uint8_t bus = 0; bus < bus_count_; bus++) {
+    bitmasks_[bus] = 0;
+    if (PIN_TO_BASEREG(pins[bus]) == base_reg_) {
+      pinMode(pins[bus], INPUT);
+      bitmasks_[bus] = PIN_TO_BITMASK(pins[bus]);
+    }
+  }
+  present_ = 0;
+#if ONEWIRE_ASYNC
+  beginTimer();
+#endif
+}
+
+void OneWireEngine::step(void) {
+  IO_REG_TYPE mask = bitmask_;
+  volatile IO_REG_TYPE *reg = base_reg_;
+
+  // Reset & Presence Pulses
+  switch (phase_) {
+    case kResetLow:
+      mask &= DIRECT_READ_PORT(reg); // a bus held low cannot answer
+      bitmask_ = mask;
+      if (!mask) {
+        finish();
+        return;
+      }
+      DIRECT_WRITE_LOW(reg, mask);
+      DIRECT_MODE_OUTPUT(reg, mask);
+      phase_ = kResetRelease;
+      setTimer(480);
+      return;
+    case kResetRelease:
+      DIRECT_MODE_INPUT(reg, mask);
+      phase_ = kPresence;
+      setTimer(70);
+      return;
+    case kPresence: {
+      IO_REG_TYPE port = DIRECT_READ_PORT(reg);
+      for (uint8_t bus = 0; bus < bus_count_; bus++) {
+        if ((mask & bitmasks_[bus]) && !(port & bitmasks_[bus])) {
+          present_ |= 1 << bus;
+        }
+      }
+      bitmask_ &= ~port; // buses without a device sit out
+      if (!bitmask_) {
+        finish();
+        return;
+      }
+      phase_ = kSlot;
+      setTimer(410);
+      return;
+    }
+    case kReleaseZero: // end of a write 0 slot
+      DIRECT_WRITE_HIGH(reg, zero_bitmask_);
+      phase_ = kSlot;
+      setTimer(5);
+      return;
+    case kSlot:
+      break;
+  }
+
+  // Write Slot, 1s Are Released Within The Interrupt, 0s On The Next One
+  uint16_t write_bits = (uint16_t)write_count_ * 8;
+  if (bit_ < write_bits) {
+    IO_REG_TYPE zero_mask = 0;
+    for (uint8_t bus = 0; bus < bus_count_; bus++) {
+      if (!(write_data_[bus * write_count_ + (bit_ >> 3)] & (1 << (bit_ & 7)))) {
+        zero_mask |= bitmasks_[bus];
+      }
+    }
+    zero_mask &= mask;
+    bit_++;
+    DIRECT_WRITE_LOW(reg, mask);
+    DIRECT_MODE_OUTPUT(reg, mask);
+    if (zero_mask == mask) { // only 0s, no need to wait here
+      zero_bitmask_ = zero_mask;
+      phase_ = kReleaseZero;
+      setTimer(65);
+      return;
+    }
+    delayMicroseconds(10);
+    DIRECT_WRITE_HIGH(reg, mask & ~zero_mask);
+    if (zero_mask) {
+      zero_bitmask_ = zero_mask;
+      phase_ = kReleaseZero;
+    }
+    setTimer(55);
+    return;
+  }
+
+  // Read Slot, Sampled 13 us After It Starts
+  if (bit_ < write_bits + (uint16_t)read_count_ * 8) {
+    uint16_t n = bit_ - write_bits;
+    bit_++;
+    DIRECT_MODE_OUTPUT(reg, mask);
+    DIRECT_WRITE_LOW(reg, mask);
+    delayMicroseconds(3);
+    DIRECT_MODE_INPUT(reg, mask);
+    delayMicroseconds(10);
+    IO_REG_TYPE port = DIRECT_READ_PORT(reg);
+    for (uint8_t bus = 0; bus < bus_count_; bus++) {
+      if (!(mask & bitmasks_[bus])) {
+        continue;
+      }
+      uint8_t &data = read_data_[bus * read_count_ + (n >> 3)];
+      if ((n & 7) == 0) {
+        data = 0;
+      }
+      if (port & bitmasks_[bus]) {
+        data |= 1 << (n & 7);
+      }
+    }
+    setTimer(53);
+    return;
+  }
+  finish();
+}
+
+void OneWireEngine::finish(void) {
+  // Release Buses Unless They Power A Conversion
+  stopTimer();
+  if (!power_) {
+    DIRECT_MODE_INPUT(base_reg_, bitmask_);
+    DIRECT_WRITE_LOW(base_reg_, bitmask_);
+  }
+  active_ = NULL;
+}
@@ -0,0 +1,116 @@
+/**
+ *  \file support_one_wire_engine.h
+ *  \brief Support module that runs 1-wire transactions in the background.
+ *  \details A transaction is a reset, then the bytes to write, then the bytes to read,
+ *  e.g. select() and Read Scratchpad then the 9 scratchpad bytes. With ONEWIRE_ASYNC set
+ *  (the default on AVR and the host build) start() returns right away and the slots are
+ *  run from the compare match A interrupt of Timer1: the interrupt does the part of a
+ *  slot that must be timed to the microsecond (at most 13 us, the low pulse of a read
+ *  slot and its sample) and schedules the next one, waits of 50 us and longer (the rest
+ *  of a slot, the 480 us reset pulse and the presence pulse) are timer compares. The loop
+ *  keeps running and polls isBusy() for completion, a transaction takes about 1 ms for
+ *  the reset and 70 us per bit. Without ONEWIRE_ASYNC start() runs the same slots with
+ *  delayMicroseconds() and returns when they are done. There is one timer, so a single
+ *  transaction runs at a time over every engine, start() fails while another is running.
+ *  Searching the bus is left to OneWire.
+ *
+ *  An engine can drive up to kMaxBuses buses on pins of the same port in lockstep, e.g.
+ *  one bus per tank: every slot pulls the pins of all buses low with one register write,
+ *  releases the buses writing a 1 after 10 us and the ones writing a 0 after 65 us, and
+ *  samples the presence pulses and read slots with one read of the port, so a transaction
+ *  on N buses takes the time of one. Each bus writes and reads its own bytes, a bus
+ *  without a presence pulse sits out the rest of the transaction. Pins on another port
+ *  than the first are left out. Several buses need the port registers of an AVR.
+ *  \author Jake Rye
+ */
+#ifndef SUPPORT_ONE_WIRE_ENGINE_H
+#define SUPPORT_ONE_WIRE_ENGINE_H
+
+#if ARDUINO >= 100
+ #include "Arduino.h"
+#else
+ #include "WProgram.h"
+#endif
+
+#include "support_one_wire.h"
+
+#ifndef ONEWIRE_ASYNC
+#if defined(__AVR__) || defined(GRO_HOST)
+#define ONEWIRE_ASYNC 1 // uses Timer1
+#else
+#define ONEWIRE_ASYNC 0
+#endif
+#endif
+
+/**
+ * \brief Support module that runs 1-wire transactions in the background.
+ */
+class OneWireEngine {
+  public:
+    // Public Functions
+    OneWireEngine(uint8_t pin);
+
+    /**
+     * \brief Drives a bus on each of pin_count pins, bus 0 on the first.
+     */
+    OneWireEngine(const uint8_t *pins, uint8_t pin_count);
+
+    /**
+     * \brief Starts a transaction on the buses set in buses (bit 0 for bus 0): a reset,
+     * write_count bytes of write_data, then read_count bytes into read_data. The data of
+     * bus n starts n * write_count (read_count) bytes in. The buffers must stay valid until
+     * it is done. With power the buses are driven high when done, for parasite powered
+     * devices, until the next transaction. Returns false if a transaction is running.
+     */
+    bool start(const uint8_t *write_data, uint8_t write_count, uint8_t *read_data, uint8_t read_count,
+               bool power = false, uint8_t buses = 0xFF);
+
+    /**
+     * \brief Returns true while the transaction started last is running.
+     */
+    bool isBusy(void);
+
+    /**
+     * \brief Returns true if a device on bus answered the reset of the last transaction.
+     * Nothing is written to or read from the bus otherwise.
+     */
+    bool isPresent(uint8_t bus = 0);
+
+    /**
+     * \brief Returns the number of buses driven.
+     */
+    uint8_t getBuses(void);
+
+    /**
+     * \brief Runs the next step of the running transaction. Called by the timer interrupt.
+     */
+    static void handleTimer(void);
+
+    // Public Constants
+    static const uint8_t kMaxBuses = 4;
+
+  private:
+    // Private Functions
+    void begin(const uint8_t *pins, uint8_t pin_count);
+    void step(void);
+    void finish(void);
+
+    // Private Variables
+    enum Phase {kResetLow, kResetRelease, kPresence, kReleaseZero, kSlot};
+    static OneWireEngine * volatile active_; // engine running a transaction
+    IO_REG_TYPE bitmasks_[kMaxBuses]; // pin of each bus
+    volatile IO_REG_TYPE *base_reg_;
+    uint8_t bus_count_;
+    IO_REG_TYPE bitmask_; // pins of the buses in the transaction
+    IO_REG_TYPE zero_bitmask_; // pins of the buses writing a 0 in the slot
+    const uint8_t *write_data_;
+    uint8_t *read_data_;
+    uint8_t write_count_;
+    uint8_t read_count_;
+    uint16_t bit_; // next slot, write bits first
+    bool power_;
+    volatile Phase phase_;
+    volatile uint8_t present_; // bit of each bus that answered the reset
+};
+
+#endif // SUPPORT_ONE_WIRE_ENGINE_H_
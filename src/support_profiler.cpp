@@ -0,0 +1,80 @@
+/** 
+ *  \file support_profiler.cpp
+ *  \brief Support module that times function calls.
+ *  \details See support_profiler.h for details.
+ *  \author Jake Rye
+ */
+#include "support_profiler.h"
+
+//--------------------------------------------------PUBLIC-------------------------------------------//
+ModuleProfiler::ModuleProfiler(void) {
+  reset();
+}
+
+void ModuleProfiler::start(void) {
+  start_time_ = micros();
+}
+
+void ModuleProfiler::stop(void) {
+  record(micros() - start_time_);
+}
+
+void ModuleProfiler::reset(void) {
+  count = 0;
+  min_time = 0;
+  max_time = 0;
+  mean_time = 0;
+  for (int i = 0; i < PROFILER_HISTOGRAM_BUCKETS; i++) {
+    histogram[i] = 0;
+  }
+}
+
+void ModuleProfiler::printStats(Print &out) {
+  // Print Statistics
+  out.print(F("{\"n\":"));
+  out.print(count);
+  out.print(F(",\"min\":"));
+  out.print(min_time);
+  out.print(F(",\"max\":"));
+  out.print(max_time);
+  out.print(F(",\"mean\":"));
+  out.print((uint32_t)(mean_time + 0.5));
+
+  // Print Histogram
+  out.print(F(",\"hist\":["));
+  for (int i = 0; i < PROFILER_HISTOGRAM_BUCKETS; i++) {
+    if (i > 0) {
+      out.print(',');
+    }
+    out.print(histogram[i]);
+  }
+  out.print(F("]}"));
+}
+
+//-------------------------------------------------PRIVATE-------------------------------------------//
+void ModuleProfiler::record(uint32_t duration) {
+  if (count == 0xFFFFFFFF) {
+    return; // saturated
+  }
+  count++;
+
+  // Update Min, Max, & Mean
+  if ((count == 1) || (duration < min_time)) {
+    min_time = duration;
+  }
+  if (duration > max_time) {
+    max_time = duration;
+  }
+  mean_time += ((float)duration - mean_time) / count;
+
+  // Update Histogram, Bucket Edges Grow By 4x Starting At 16 us
+  int bucket = 0;
+  uint32_t edge = 16;
+  while ((bucket < PROFILER_HISTOGRAM_BUCKETS - 1) && (duration >= edge)) {
+    bucket++;
+    edge <<= 2;
+  }
+  if (histogram[bucket] < 0xFFFF) {
+    histogram[bucket]++;
+  }
+}
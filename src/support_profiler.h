@@ -0,0 +1,66 @@
+/** 
+ *  \file support_profiler.h
+ *  \brief Support module that times function calls.
+ *  \details Call *.start() before and *.stop() after the code being timed. Each
+ *  measurement is taken with micros() (4 us resolution on a 16 MHz board) and updates
+ *  the call count, min, max, running mean, and a log scale histogram. Bucket i counts
+ *  durations below 16*4^i us: <16us, <64us, <256us, <1ms, <4ms, <16ms, <65ms, longer.
+ *  Counts saturate instead of rolling over. Uses 32 bytes of RAM per instance.
+ *  \author Jake Rye
+ */
+#ifndef SUPPORT_PROFILER_H
+#define SUPPORT_PROFILER_H
+
+#if ARDUINO >= 100
+ #include "Arduino.h"
+#else
+ #include "WProgram.h"
+#endif
+
+#define PROFILER_HISTOGRAM_BUCKETS 8
+
+/**
+ * \brief Support module that times function calls.
+ */
+class ModuleProfiler {
+  public:
+    // Public Functions
+    ModuleProfiler(void);
+
+    /**
+     * \brief Marks the beginning of a timed call.
+     */
+    void start(void);
+
+    /**
+     * \brief Marks the end of a timed call and updates the statistics.
+     */
+    void stop(void);
+
+    /**
+     * \brief Clears all statistics.
+     */
+    void reset(void);
+
+    /**
+     * \brief Prints statistics as a JSON object to out.
+     * Example: {"n":12,"min":8,"max":412,"mean":52,"hist":[3,8,0,1,0,0,0,0]}
+     */
+    void printStats(Print &out);
+
+    // Public Variables
+    uint32_t count; // calls
+    uint32_t min_time; // microseconds
+    uint32_t max_time; // microseconds
+    float mean_time; // microseconds
+    uint16_t histogram[PROFILER_HISTOGRAM_BUCKETS];
+
+  private:
+    // Private Functions
+    void record(uint32_t duration);
+
+    // Private Variables
+    uint32_t start_time_;
+};
+
+#endif // SUPPORT_PROFILER_H_
@@ -0,0 +1,156 @@
+/**
+ *  \file support_pulse_capture.cpp
+ *  \brief Support module that records the changes of pins on one port.
+ *  \details See support_pulse_capture.h for details.
+ *  \author Jake Rye
+ */
+#include "support_pulse_capture.h"
+
+#if defined(GRO_HOST)
+#define READ_PORT(reg) (hostPortRead(reg))
+#else
+#define READ_PORT(reg) (*(reg))
+#endif
+
+//--------------------------------------------------PUBLIC-------------------------------------------//
+PulseCapture * volatile PulseCapture::active_ = NULL;
+uint16_t PulseCapture::start_time_ = 0;
+uint8_t PulseCapture::start_port_ = 0;
+volatile uint16_t PulseCapture::change_count_ = 0;
+uint16_t PulseCapture::times_[kMaxChanges];
+uint8_t PulseCapture::ports_[kMaxChanges];
+
+PulseCapture::PulseCapture(uint8_t pin) {
+  begin(&pin, 1);
+}
+
+PulseCapture::PulseCapture(const uint8_t *pins, uint8_t pin_count) {
+  begin(pins, pin_count);
+}
+
+bool PulseCapture::isAvailable(void) {
+  for (uint8_t n = 0; n < pin_count_; n++) {
+    if (interrupts_[n] == NOT_AN_INTERRUPT) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool PulseCapture::start(void) {
+  if ((active_ != NULL) || !isAvailable()) {
+    return false;
+  }
+  noInterrupts();
+  reset(micros());
+  active_ = this;
+  interrupts();
+  for (uint8_t n = 0; n < pin_count_; n++) {
+    if (bitmasks_[n]) {
+      attachInterrupt(interrupts_[n], handleChange, CHANGE);
+    }
+  }
+  return true;
+}
+
+void PulseCapture::stop(void) {
+  if (active_ != this) {
+    return;
+  }
+  for (uint8_t n = 0; n < pin_count_; n++) {
+    if (bitmasks_[n]) {
+      detachInterrupt(interrupts_[n]);
+    }
+  }
+  active_ = NULL;
+}
+
+bool PulseCapture::sample(uint16_t change_count, uint16_t idle_passes) {
+  if (active_ != NULL) {
+    return false;
+  }
+  uint8_t bitmask = 0;
+  for (uint8_t n = 0; n < pin_count_; n++) {
+    bitmask |= bitmasks_[n];
+  }
+
+  // Read The Port Once A Pass, Keeping The Passes The Same Length
+  reset(0);
+  uint8_t last_port = start_port_;
+  uint16_t time = 0;
+  uint16_t idle = 0;
+  while ((change_count_ < change_count) && (change_count_ < kMaxChanges) && (idle < idle_passes)) {
+    uint8_t port = READ_PORT(port_reg_);
+    if ((port ^ last_port) & bitmask) {
+      times_[change_count_] = time;
+      ports_[change_count_] = port;
+      change_count_++;
+      last_port = port;
+      idle = 0;
+    }
+    else {
+      idle++;
+    }
+    time++;
+    delayMicroseconds(1);
+  }
+  return true;
+}
+
+uint16_t PulseCapture::getChanges(void) {
+  // Read The Count In One Piece, The Interrupt May Change It Meanwhile
+  noInterrupts();
+  uint16_t change_count = change_count_;
+  interrupts();
+  return change_count;
+}
+
+uint16_t PulseCapture::getTime(uint16_t n) {
+  if (n == kStart) {
+    return start_time_;
+  }
+  return times_[n];
+}
+
+uint8_t PulseCapture::getPort(uint16_t n) {
+  if (n == kStart) {
+    return start_port_;
+  }
+  return ports_[n];
+}
+
+uint8_t PulseCapture::getBitmask(uint8_t n) {
+  return (n < pin_count_) ? bitmasks_[n] : 0;
+}
+
+void PulseCapture::handleChange(void) {
+  if (active_ == NULL) {
+    return;
+  }
+  uint16_t n = change_count_;
+  if (n < kMaxChanges) {
+    times_[n] = micros();
+    ports_[n] = READ_PORT(active_->port_reg_);
+    change_count_ = n + 1;
+  }
+}
+
+//-------------------------------------------------PRIVATE-------------------------------------------//
+void PulseCapture::begin(const uint8_t *pins, uint8_t pin_count) {
+  // Keep Pins On The Port Of The First
+  pin_count_ = (pin_count > kMaxPins) ? kMaxPins : pin_count;
+  port_reg_ = portInputRegister(digitalPinToPort(pins[0]));
+  for (uint8_t n = 0; n < pin_count_; n++) {
+    interrupts_[n] = digitalPinToInterrupt(pins[n]);
+    bitmasks_[n] = 0;
+    if (digitalPinToPort(pins[n]) == digitalPinToPort(pins[0])) {
+      bitmasks_[n] = digitalPinToBitMask(pins[n]);
+    }
+  }
+}
+
+void PulseCapture::reset(uint16_t time) {
+  change_count_ = 0;
+  start_time_ = time;
+  start_port_ = READ_PORT(port_reg_);
+}
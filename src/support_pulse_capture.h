@@ -0,0 +1,114 @@
+/**
+ *  \file support_pulse_capture.h
+ *  \brief Support module that records the changes of pins on one port.
+ *  \details Between start() and stop() every change of a pin runs its external interrupt,
+ *  which stores the time of the change (the low 16 bits of micros(), 4 us steps at 16 MHz)
+ *  and the port register after it. The loop keeps running, polls getChanges() and measures
+ *  the pulses when the transfer is over, e.g. the 84 changes of a DHT22 transfer take about
+ *  5 ms. Only pins with an external interrupt can be captured (2, 3 and 18 to 21 on the
+ *  Mega, isAvailable() tells), the pin change interrupts are left to SoftwareSerial. On
+ *  other pins sample() records the changes in a timed loop instead, blocking until they
+ *  are over, with times counted in passes of the loop.
+ *
+ *  A capture records up to kMaxPins pins on the port of the first at once, e.g. several
+ *  sensors answering together: every change is stored with the whole port register, and
+ *  the changes of each pin are told apart by its bit. Pins on another port are left out.
+ *  One capture runs at a time over every instance, so they share one record of changes,
+ *  kept until the next capture starts.
+ *  \author Jake Rye
+ */
+#ifndef SUPPORT_PULSE_CAPTURE_H
+#define SUPPORT_PULSE_CAPTURE_H
+
+#if ARDUINO >= 100
+ #include "Arduino.h"
+#else
+ #include "WProgram.h"
+#endif
+
+/**
+ * \brief Support module that records the changes of pins on one port.
+ */
+class PulseCapture {
+  public:
+    // Public Functions
+    PulseCapture(uint8_t pin);
+
+    /**
+     * \brief Records pin_count pins of the port of the first at once.
+     */
+    PulseCapture(const uint8_t *pins, uint8_t pin_count);
+
+    /**
+     * \brief Returns true if every pin has an external interrupt to capture with.
+     */
+    bool isAvailable(void);
+
+    /**
+     * \brief Forgets the changes recorded and records the next ones. Returns false if
+     * another capture is running or a pin has no external interrupt.
+     */
+    bool start(void);
+
+    /**
+     * \brief Stops recording changes.
+     */
+    void stop(void);
+
+    /**
+     * \brief Forgets the changes recorded and records the next ones in a loop, until
+     * change_count are recorded or none comes for idle_passes passes of the loop (a pass
+     * takes a little over 1 us). Times are in passes from then on. Returns false if
+     * another capture is running.
+     */
+    bool sample(uint16_t change_count, uint16_t idle_passes);
+
+    /**
+     * \brief Returns the number of changes recorded, at most kMaxChanges.
+     */
+    uint16_t getChanges(void);
+
+    /**
+     * \brief Returns the time of change n, or of the start if n is kStart.
+     */
+    uint16_t getTime(uint16_t n);
+
+    /**
+     * \brief Returns the port register after change n, or at the start if n is kStart.
+     */
+    uint8_t getPort(uint16_t n);
+
+    /**
+     * \brief Returns the bit of pin n in the port register, 0 if it is left out.
+     */
+    uint8_t getBitmask(uint8_t n = 0);
+
+    /**
+     * \brief Records a change of the active capture. Called by the external interrupts.
+     */
+    static void handleChange(void);
+
+    // Public Constants
+    static const uint8_t kMaxPins = 3;
+    static const uint16_t kMaxChanges = 86 * kMaxPins + 8; // a DHT22 start pulse & transfer per pin, with margin
+    static const uint16_t kStart = 0xFFFF;
+
+  private:
+    // Private Functions
+    void begin(const uint8_t *pins, uint8_t pin_count);
+    void reset(uint16_t time);
+
+    // Private Variables
+    static PulseCapture * volatile active_; // capture recording changes
+    static uint16_t start_time_;
+    static uint8_t start_port_;
+    static volatile uint16_t change_count_;
+    static uint16_t times_[kMaxChanges];
+    static uint8_t ports_[kMaxChanges];
+    int interrupts_[kMaxPins];
+    uint8_t bitmasks_[kMaxPins];
+    uint8_t pin_count_;
+    volatile uint8_t *port_reg_;
+};
+
+#endif // SUPPORT_PULSE_CAPTURE_H_